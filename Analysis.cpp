@@ -0,0 +1,130 @@
+#include "Analysis.h"
+#include <QSettings>
+
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// return settings key of a measured step
+    static QString timingKey( Connection::Device _device, qint32 _baud, const QString& _step )
+    {
+      return QString("timing/%1/%2/%3").arg(_device).arg(_baud).arg(_step);
+    }
+
+    Analysis::Analysis( const Image& _image, Connection::Device _device ) :
+      image_(_image),
+      device_(_device),
+      filled_(0)
+    {
+      foreach( const Image::Range& _range, image_.ranges() )
+        filled_ += _range.size_;
+      if( image_.isEmpty() )
+        return;
+      blocks_ = DeviceModel::blocks(_device, image_.start());
+      // find blocks with data by looking at the blank page bitmap
+      foreach( const DeviceModel::Block& _block, blocks_ )
+      {
+        unsigned long _first = qMax(_block.address_, image_.start());
+        unsigned long _last = qMin(_block.address_ + (_block.size_ - 1), image_.endAddress() - 1);
+        if( _last < _first )
+          continue;
+        for( int i = (_first - image_.start()) / Image::PageSize; i <= (int)((_last - image_.start()) / Image::PageSize); ++i )
+          if( !image_.isBlank(i) )
+          {
+            usedBlocks_.append(_block);
+            break;
+          }
+      }
+    }
+    const QVector<DeviceModel::Block>& Analysis::blocks() const
+    {
+      return blocks_;
+    }
+    const QVector<DeviceModel::Block>& Analysis::usedBlocks() const
+    {
+      return usedBlocks_;
+    }
+    unsigned long Analysis::filled() const
+    {
+      return filled_;
+    }
+    void Analysis::report( QTextStream& _out, double _latency ) const
+    {
+      if( image_.isEmpty() )
+      {
+        _out << "image is empty" << endl;
+        return;
+      }
+      _out << "image: " << QString::number(image_.start(),16) << " - " << QString::number(image_.endAddress()-1,16) << " = " << image_.size()/1024 << "KB" << endl;
+      // address ranges
+      _out << "ranges:" << endl;
+      foreach( const Image::Range& _range, image_.ranges() )
+        _out << "  " << QString::number(_range.address_,16) << " - " << QString::number(_range.address_ + _range.size_ - 1,16) << " (" << _range.size_ << " bytes)" << endl;
+      // pages and fill ratio
+      _out << "pages: " << image_.relevantCount() << " of " << image_.pageCount() << " not blank ("
+           << QString::number(100.0 * image_.relevantCount() / image_.pageCount(), 'f', 1) << "%)" << endl;
+      _out << "fill ratio: " << filled_ << " of " << image_.size() << " bytes ("
+           << QString::number(100.0 * filled_ / image_.size(), 'f', 1) << "%)" << endl;
+      // blocks
+      _out << "blocks to erase: " << usedBlocks_.size() << " of " << blocks_.size() << " with data" << endl;
+      foreach( const DeviceModel::Block& _block, usedBlocks_ )
+        _out << "  " << QString::number(_block.address_,16) << " (" << _block.size_/1024 << "KB)" << endl;
+      // blocks below the image are left out, the device may have more
+      const int _eraseAll = DeviceModel::eraseTime(blocks_);
+      _out << "erase time: " << _eraseAll << " ms (" << blocks_.size() << " blocks from " << QString::number(blocks_.last().address_,16) << " to top), "
+           << DeviceModel::eraseTime(usedBlocks_) << " ms (blocks with data)" << endl;
+      // estimated times per baud rate
+      _out << "estimated times in ms (latency " << _latency << " ms, * = measured):" << endl;
+      _out << "  baud     program   verify    total" << endl;
+      foreach( qint32 _baud, DeviceModel::baudRates() )
+      {
+        double _program = measured(device_, _baud, "program");
+        double _verify = measured(device_, _baud, "verify");
+        const bool _measuredProgram = _program >= 0;
+        const bool _measuredVerify = _verify >= 0;
+        if( !_measuredProgram )
+          _program = DeviceModel::programTime(device_, _baud, _latency);
+        if( !_measuredVerify )
+          _verify = DeviceModel::verifyTime(device_, _baud, _latency);
+        _program *= image_.relevantCount();
+        _verify *= image_.relevantCount();
+        _out << "  " << QString::number(_baud).leftJustified(8)
+             << " " << (QString::number(qRound(_program)) + (_measuredProgram ? "*" : "")).leftJustified(9)
+             << " " << (QString::number(qRound(_verify)) + (_measuredVerify ? "*" : "")).leftJustified(9)
+             << " " << qRound(DeviceModel::connectTime() + _eraseAll + _program + _verify) << endl;
+      }
+      // loader runs at any baud rate and is only known from measured runs
+      QSettings _settings("fkgo", "flash-renesas");
+      _settings.beginGroup(QString("timing/%1").arg(device_));
+      bool _header = false;
+      foreach( const QString& _group, _settings.childGroups() )
+      {
+        const qint32 _baud = _group.toInt();
+        const double _program = measured(device_, _baud, "loader-program");
+        const double _verify = measured(device_, _baud, "loader-verify");
+        if( _program < 0 && _verify < 0 )
+          continue;
+        if( !_header )
+        {
+          _out << "measured times through loader in ms:" << endl;
+          _out << "  baud     program   verify" << endl;
+          _header = true;
+        }
+        _out << "  " << QString::number(_baud).leftJustified(8)
+             << " " << (_program < 0 ? QString("-") : QString::number(qRound(_program * image_.relevantCount()))).leftJustified(9)
+             << " " << (_verify < 0 ? QString("-") : QString::number(qRound(_verify * image_.relevantCount()))) << endl;
+      }
+    }
+    void Analysis::remember( Connection::Device _device, qint32 _baud, const QString& _step, double _time )
+    {
+      QSettings _settings("fkgo", "flash-renesas");
+      _settings.setValue(timingKey(_device, _baud, _step), _time);
+    }
+    double Analysis::measured( Connection::Device _device, qint32 _baud, const QString& _step )
+    {
+      QSettings _settings("fkgo", "flash-renesas");
+      return _settings.value(timingKey(_device, _baud, _step), -1.0).toDouble();
+    }
+  }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "DeviceModel.h"
+#include "Image.h"
+#include <QTextStream>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// analysis of an image and estimate of its flash time
+    struct Analysis
+    {
+    public:
+      /// default turnaround time of an USB serial adapter in milliseconds
+      enum { DefaultLatency = 2 };
+
+      /** @brief analyze an image
+       * @param _image image to analyze
+       * @param _device device type the image is made for
+       */
+      Analysis( const Image& _image, Connection::Device _device );
+      /// return blocks covering the image
+      const QVector<DeviceModel::Block>& blocks() const;
+      /// return blocks containing non blank pages
+      const QVector<DeviceModel::Block>& usedBlocks() const;
+      /// return number of bytes filled by records
+      unsigned long filled() const;
+      /** @brief write report
+       * @param _out stream to write to
+       * @param _latency turnaround time per response in milliseconds
+       */
+      void report( QTextStream& _out, double _latency ) const;
+      /** @brief remember measured time per page of a step
+       * @param _device device type
+       * @param _baud baud rate
+       * @param _step "program", "verify", "loader-program" or "loader-verify"
+       * @param _time milliseconds per page
+       */
+      static void remember( Connection::Device _device, qint32 _baud, const QString& _step, double _time );
+      /// return measured milliseconds per page of a step or a negative value if unknown
+      static double measured( Connection::Device _device, qint32 _baud, const QString& _step );
+
+    private:
+      /// analyzed image
+      Image image_;
+      /// device type
+      Connection::Device device_;
+      /// blocks covering the image
+      QVector<DeviceModel::Block> blocks_;
+      /// blocks containing non blank pages
+      QVector<DeviceModel::Block> usedBlocks_;
+      /// bytes filled by records
+      unsigned long filled_;
+    };
+  }
+}
@@ -0,0 +1,69 @@
+#include "BlankCheck.h"
+#include "Image.h"
+#include <QDebug>
+#include <cstring>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    BlankCheck::BlankCheck( Connection& _connection, int _stride, const Image& _image ) :
+      connection_(_connection),
+      stride_(qMax(1,_stride)),
+      image_(_image)
+    {
+    }
+    Connection::Status BlankCheck::check( const DeviceModel::Block& _block, bool& _blank )
+    {
+      char _page[Image::PageSize];
+      const unsigned long _lastPage = _block.size_ - Image::PageSize;
+      _blank = true;
+      for( unsigned long _offset = 0; _offset <= _lastPage; _offset += Image::PageSize )
+      {
+        // sample every n-th page and the last page of the block, but read all pages
+        // the image leaves blank since verifying cannot find leftovers there
+        const unsigned long _address = _block.address_ + _offset;
+        const bool _sampled = 0 == (_offset / Image::PageSize) % stride_ || _offset == _lastPage;
+        if( !_sampled && programmed(_address) )
+          continue;
+        // a stale blank page must not survive a failed read
+        memset(_page, 0x00, sizeof(_page));
+        Connection::Status _status = connection_.readPage(_address, _page);
+        if( Connection::NotConnected == _status )
+          return _status;
+        // anything but a complete read means the block has to be erased
+        if( Connection::Ready != _status )
+        {
+          qDebug() << "BlankCheck::check: cannot read page at" << QString::number(_address,16);
+          _blank = false;
+          break;
+        }
+        if( !Image::isBlank(_page, Image::PageSize) )
+        {
+          qDebug() << "BlankCheck::check: page at" << QString::number(_address,16) << "is not blank";
+          _blank = false;
+          break;
+        }
+      }
+      return Connection::Ready;
+    }
+    bool BlankCheck::programmed( unsigned long _address ) const
+    {
+      return image_.contains(_address) && !image_.isBlank((_address - image_.start()) / Image::PageSize);
+    }
+    Connection::Status BlankCheck::check( const QVector<DeviceModel::Block>& _blocks, QVector<DeviceModel::Block>& _dirty )
+    {
+      _dirty.clear();
+      foreach( const DeviceModel::Block& _block, _blocks )
+      {
+        bool _blank;
+        Connection::Status _status = check(_block, _blank);
+        if( Connection::Ready != _status )
+          return _status;
+        if( !_blank )
+          _dirty.append(_block);
+      }
+      return Connection::Ready;
+    }
+  }
+}
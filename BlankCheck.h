@@ -0,0 +1,49 @@
+#pragma once
+#include "DeviceModel.h"
+#include "Image.h"
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /** @brief find out which flash blocks need to be erased
+     *
+     * The boot ROM of these devices offers no blank check command, so
+     * pages are read back. A stride of 1 reads every page, larger strides
+     * sample every n-th page of a block plus its last page (vector table).
+     * Pages the image leaves blank are always read, because verifying the
+     * programmed pages cannot reveal old contents there.
+     */
+    struct BlankCheck
+    {
+    public:
+      /** @brief create a blank check
+       * @param _connection unlocked connection to read from
+       * @param _stride read every n-th page
+       * @param _image image to be programmed (its blank pages are always read)
+       */
+      BlankCheck( Connection& _connection, int _stride, const Image& _image = Image() );
+      /** @brief check if a block is blank
+       * @param _block block to check
+       * @param _blank receives true if all read pages were blank (false if a page could not be read)
+       */
+      Connection::Status check( const DeviceModel::Block& _block, bool& _blank );
+      /** @brief collect blocks which are not blank
+       * @param _blocks blocks to check
+       * @param _dirty receives blocks which need to be erased
+       */
+      Connection::Status check( const QVector<DeviceModel::Block>& _blocks, QVector<DeviceModel::Block>& _dirty );
+
+    private:
+      /// return true if the image programs the page at the given address
+      bool programmed( unsigned long _address ) const;
+
+      /// connection to read from
+      Connection& connection_;
+      /// distance of read pages
+      int stride_;
+      /// image to be programmed
+      Image image_;
+    };
+  }
+}
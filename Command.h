@@ -0,0 +1,114 @@
+#pragma once
+#include "Connection.h"
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// remote commands
+    enum
+    {
+      /// erase a block
+      BLOCK_ERASE   = 0x20,
+      /// program a page
+      PROGRAM_PAGE  = 0x41,
+      /// most significant byte
+      MSB           = 0x48,
+      /// clear remote status
+      CLEAR_STATUS  = 0x50,
+      /// format remote side
+      ERASE         = 0xA7,
+      ALL           = 0xD0,
+
+      /// request remote status
+      GET_STATUS    = 0x70,
+
+      /// set remote baud rate
+      BAUD_9600     = 0xB0,
+      BAUD_19200,
+      BAUD_38400,
+      BAUD_57600,
+      BAUD_115200,
+
+      /// unlock flash with ID
+      UNLOCK        = 0xF5,
+
+      /// download a program into RAM and run it
+      DOWNLOAD      = 0xFA,
+
+      /// poll version
+      GET_VERSION   = 0xFB,
+
+      /// read a page of memory
+      READ_PAGE     = 0xFF
+    };
+
+    /// command frame of fixed size which lives on the stack
+    template<int N>
+    struct Frame
+    {
+      /// frame bytes
+      char bytes_[N];
+      /// return frame bytes
+      const char* data() const { return bytes_; }
+      /// return size of the frame
+      static constexpr int size() { return N; }
+    };
+
+    /** @brief command encoders for 24 bit address devices (R8C, M16C, M32C)
+     * @tparam D device type
+     */
+    template<Connection::Device D>
+    struct Command
+    {
+      /// header of a page command
+      typedef Frame<3> PageHeader;
+      /// header of an unlock command (without ID)
+      typedef Frame<5> UnlockHeader;
+      /// block erase command
+      typedef Frame<4> BlockErase;
+      /// encode a page command header (address bits 8..23)
+      static constexpr PageHeader page( char _cmd, unsigned long _address )
+      {
+        return PageHeader{{ _cmd, char(_address >> 8), char(_address >> 16) }};
+      }
+      /// encode an unlock command header followed by the ID length
+      static constexpr UnlockHeader unlock( unsigned long _address, char _size )
+      {
+        return UnlockHeader{{ char(UNLOCK), char(_address), char(_address >> 8), char(_address >> 16), _size }};
+      }
+      /// encode a block erase command for the block containing the given address
+      static constexpr BlockErase blockErase( unsigned long _address )
+      {
+        return BlockErase{{ char(BLOCK_ERASE), char(_address >> 8), char(_address >> 16), char(ALL) }};
+      }
+    };
+
+    /// command encoders for R32C which prefixes addresses with the most significant byte
+    template<>
+    struct Command<Connection::R32C>
+    {
+      /// header of a page command
+      typedef Frame<5> PageHeader;
+      /// header of an unlock command (without ID)
+      typedef Frame<7> UnlockHeader;
+      /// block erase command
+      typedef Frame<6> BlockErase;
+      /// encode a page command header (address bits 8..31)
+      static constexpr PageHeader page( char _cmd, unsigned long _address )
+      {
+        return PageHeader{{ char(MSB), char(_address >> 24), _cmd, char(_address >> 8), char(_address >> 16) }};
+      }
+      /// encode an unlock command header followed by the ID length
+      static constexpr UnlockHeader unlock( unsigned long _address, char _size )
+      {
+        return UnlockHeader{{ char(MSB), char(_address >> 24), char(UNLOCK), char(_address), char(_address >> 8), char(_address >> 16), _size }};
+      }
+      /// encode a block erase command for the block containing the given address
+      static constexpr BlockErase blockErase( unsigned long _address )
+      {
+        return BlockErase{{ char(MSB), char(_address >> 24), char(BLOCK_ERASE), char(_address >> 8), char(_address >> 16), char(ALL) }};
+      }
+    };
+  }
+}
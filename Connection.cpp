@@ -1,45 +1,17 @@
 #include "Connection.h"
+#include "SerialPort.h"
+#include "TermiosPort.h"
+#include "IdCode.h"
+#include "Command.h"
 #include <QThread>
+#include <QElapsedTimer>
+#include <QStringList>
 #include <QDebug>
-#include <QSerialPortInfo>
 
 namespace Fkgo
 {
   namespace Programmer
   {
-    /// remote commands
-    enum
-    {
-      /// program a page
-      PROGRAM_PAGE  = 0x41,
-      /// most significant byte
-      MSB           = 0x48,
-      /// clear remote status
-      CLEAR_STATUS  = 0x50,
-      /// format remote side
-      ERASE         = 0xA7,
-      ALL           = 0xD0,
-
-      /// request remote status
-      GET_STATUS    = 0x70,
-
-      /// set remote baud rate
-      BAUD_9600     = 0xB0,
-      BAUD_19200,
-      BAUD_38400,
-      BAUD_57600,
-      BAUD_115200,
-
-      /// unlock flash with ID
-      UNLOCK        = 0xF5,
-
-      /// poll version
-      GET_VERSION   = 0xFB,
-
-      /// read a page of memory
-      READ_PAGE     = 0xFF
-    };
-
     Connection::Connection() :
       port_(0)
     {
@@ -49,7 +21,15 @@ namespace Fkgo
       // close port
       close();
     }
-    void Connection::open( const QString& _portName, Device _device )
+    void Connection::open( const QString& _portName, Device _device, Backend _backend )
+    {
+      // create port instance
+      if( Native == _backend )
+        open(new TermiosPort(_portName), _device, _portName);
+      else
+        open(new SerialPort(_portName), _device, _portName);
+    }
+    void Connection::open( Port* _port, Device _device, const QString& _portName )
     {
       // port shall be closed
       Q_ASSERT(port_ == 0);
@@ -57,28 +37,24 @@ namespace Fkgo
       portName_ = _portName;
       device_ = _device;
       // open port
-      qDebug() << "Connection::Connection: opening port" << _portName << "...";
+      qDebug() << "Connection::Connection: opening port" << portName_ << "...";
       if( 0 == port_ )
       {
-        // create port instance
-        port_ = new QSerialPort(portName_);
-        // setup port
+        port_ = _port;
+        // setup port and open it
         qDebug() << "Connection::Connection: set baud rate to 9600/8N1";
-        port_->setBaudRate(QSerialPort::Baud9600);
-        port_->setStopBits(QSerialPort::OneStop);
-        port_->setParity(QSerialPort::NoParity);
-        port_->setDataBits(QSerialPort::Data8);
-        // opern port
-        if( port_->open(QIODevice::ReadWrite) )
-          qDebug() << "Connection::Connection: successfully opened port" << _portName;
+        if( port_->open() )
+          qDebug() << "Connection::Connection: successfully opened port" << portName_;
         else
         {
           // abort port on failure
-          qDebug() << "Connection::Connection: failed to open port" << _portName;
+          qDebug() << "Connection::Connection: failed to open port" << portName_;
           delete port_;
           port_ = 0;
         }
       }
+      else
+        delete _port;
     }
     void Connection::close()
     {
@@ -91,6 +67,63 @@ namespace Fkgo
         port_ = 0;
       }
     }
+    bool Connection::parseLineSequence( const QString& _text, LineSequence& _sequence )
+    {
+      _sequence.clear();
+      foreach( const QString& _item, _text.split(',', QString::SkipEmptyParts) )
+      {
+        const QStringList _parts = _item.trimmed().split('=');
+        if( _parts.size() != 2 )
+          return false;
+        LineStep _step;
+        bool ok;
+        _step.value_ = _parts[1].toInt(&ok);
+        const QString _name = _parts[0].toLower();
+        if( !ok || _step.value_ < 0 )
+          return false;
+        if( "dtr" == _name && _step.value_ <= 1 )
+          _step.action_ = LineStep::Dtr;
+        else if( "rts" == _name && _step.value_ <= 1 )
+          _step.action_ = LineStep::Rts;
+        else if( "wait" == _name )
+          _step.action_ = LineStep::Wait;
+        else
+          return false;
+        _sequence.append(_step);
+      }
+      return true;
+    }
+    Connection::Status Connection::reset( const LineSequence& _sequence )
+    {
+      qDebug() << "Connection::reset: playing" << _sequence.size() << "line step(s)";
+      if( 0 == port_ )
+        return NotConnected;
+      foreach( const LineStep& _step, _sequence )
+      {
+        bool _ok = true;
+        switch( _step.action_ )
+        {
+        case LineStep::Dtr:
+          _ok = port_->setDataTerminalReady(_step.value_);
+          break;
+        case LineStep::Rts:
+          _ok = port_->setRequestToSend(_step.value_);
+          break;
+        case LineStep::Wait:
+          QThread::msleep(_step.value_);
+          break;
+        }
+        if( !_ok )
+        {
+          qDebug() << "Connection::reset: cannot change modem line";
+          return NotConnected;
+        }
+      }
+      // the boot ROM starts over at 9600 baud
+      port_->setBaudRate(9600);
+      port_->clear();
+      return Ready;
+    }
     Connection::Status Connection::autoBaud()
     {
       qDebug() << "Connection::autoBaud: connection to remote site";
@@ -126,7 +159,7 @@ namespace Fkgo
       // set baud rate to 9600
       qDebug() << "Connection::baudRate: set baud rate to 9600";
       // ensure basic baud rate
-      port_->setBaudRate(QSerialPort::Baud9600);
+      port_->setBaudRate(9600);
       // send baud rate 9600 command
       if( write(BAUD_9600) != 1 )
       {
@@ -134,7 +167,8 @@ namespace Fkgo
         return NotConnected;
       }
       // check if reply is unexpected
-      if( read(1) != QByteArray(1,BAUD_9600) )
+      char _echo;
+      if( read(&_echo, 1) != 1 || _echo != char(BAUD_9600) )
       {
         qDebug() << "Connection::baudRate: no response";
         // report failure
@@ -146,21 +180,21 @@ namespace Fkgo
         /// command to send to remote side
         char cmd_;
         /// local system baud rate
-        QSerialPort::BaudRate sys_;
+        qint32 sys_;
       }
       _alternatives[] =
       {
-        { BAUD_115200, QSerialPort::Baud115200 },
-        { BAUD_57600, QSerialPort::Baud57600 },
-        { BAUD_38400, QSerialPort::Baud38400 },
-        { BAUD_19200, QSerialPort::Baud19200 },
+        { BAUD_115200, 115200 },
+        { BAUD_57600, 57600 },
+        { BAUD_38400, 38400 },
+        { BAUD_19200, 19200 },
         // sentinel
-        { 0,QSerialPort::Baud9600 },
+        { 0, 9600 },
       };
       // try to improve the baud rate
       for( size_t i=0; _alternatives[i].cmd_; ++i )
       {
-        if( QSerialPortInfo::standardBaudRates().contains(_alternatives[i].sys_) )
+        if( port_->supportsBaudRate(_alternatives[i].sys_) )
         {
           qDebug() << "Connection::Connection: asking for baud rate " << _alternatives[i].sys_;
           // send baud rate command
@@ -168,7 +202,7 @@ namespace Fkgo
           // wait
           QThread::msleep(10);
           // check if reply is unexpected
-          if( read(1) == QByteArray(1,_alternatives[i].cmd_) )
+          if( read(&_echo, 1) == 1 && _echo == _alternatives[i].cmd_ )
           {
             // improve baud rate
             qDebug() << "Connection::Connection: set baud rate to" << _alternatives[i].sys_;
@@ -180,13 +214,21 @@ namespace Fkgo
       }
       return Ready;
     }
-    QSerialPort::BaudRate Connection::baud() const
+    qint32 Connection::baud() const
     {
       if( 0 == port_ )
         // Mama!
-        return QSerialPort::Baud9600;
+        return 9600;
       // return baud rate from port instance
-      return (QSerialPort::BaudRate)port_->baudRate();
+      return port_->baudRate();
+    }
+    bool Connection::supportsBaudRate( qint32 _baud ) const
+    {
+      return 0 != port_ && port_->supportsBaudRate(_baud);
+    }
+    bool Connection::setBaudRate( qint32 _baud )
+    {
+      return 0 != port_ && port_->setBaudRate(_baud);
     }
     Connection::Status Connection::version( QString& _version )
     {
@@ -201,7 +243,8 @@ namespace Fkgo
         return NotConnected;
       }
       // read version string
-      _version = read(8);
+      char _text[8];
+      _version = QString::fromLatin1(_text, read(_text, sizeof(_text)));
       // success
       return Ready;
     }
@@ -220,10 +263,9 @@ namespace Fkgo
         // write command: get status
         if( write(GET_STATUS) != 1 )
           return NotConnected;
-        // read response
-        QByteArray result = read(2);
-        // check result
-        if( 2 != result.size() )
+        // read response into a frame on the stack
+        char result[2];
+        if( read(result, sizeof(result)) != (int)sizeof(result) )
           continue;
         // fetch flags from status response
         bool _ready = 0x80 == (result[0] & 0x80);
@@ -244,56 +286,37 @@ namespace Fkgo
       // failed
       return Timeout;
     }
-    Connection::Status Connection::unlock(const QByteArray& _id )
+    Connection::Status Connection::unlock(const QByteArray& _id, bool _checkLocked )
     {
       qDebug() << "Connection::unlock: unlocking with" << _id.toHex();
       // check if remote side is locked
-      if( Locked != status() )
+      if( _checkLocked && Locked != status() )
         return Ready;
       // check parameter
-      if( _id.size() != 7 )
+      if( _id.size() != IdCode::Size )
         return ParameterError;
-      // prepare command sequence
-      QByteArray _seq;
+      // encode for the current device
+      switch(device_)
       {
-        // write address
-        switch(device_)
-        {
-        case R8C:
-          _seq += UNLOCK;
-          _seq += 0xdf;
-          _seq += 0xff;
-          _seq += (char)0x00;
-          break;
-        case M16C:
-          _seq += UNLOCK;
-          _seq += 0xdf;
-          _seq += 0xff;
-          _seq += 0x0f;
-          break;
-        case M32C:
-          _seq += UNLOCK;
-          _seq += 0xdf;
-          _seq += 0xff;
-          _seq += 0xff;
-          break;
-        case R32C:
-          _seq += MSB;
-          _seq += 0xff;
-          _seq += UNLOCK;
-          _seq += 0xdf;
-          _seq += 0xff;
-          _seq += 0xff;
-          break;
-        default:
-          return NotImplemented;
-        }
+      case R8C:
+        return unlockAs<R8C>(_id);
+      case M16C:
+        return unlockAs<M16C>(_id);
+      case M32C:
+        return unlockAs<M32C>(_id);
+      case R32C:
+        return unlockAs<R32C>(_id);
+      default:
+        return NotImplemented;
       }
-      // add ID to the command sequence
-      _seq += (char)_id.size();
-      _seq += _id;
-      // write command sequence
-      if( write(_seq) != _seq.size() )
+    }
+    template<Connection::Device D>
+    Connection::Status Connection::unlockAs( const QByteArray& _id )
+    {
+      // command header addresses the first ID code byte
+      const typename Command<D>::UnlockHeader _header = Command<D>::unlock(IdCode::address(D), _id.size());
+      // write command header and ID
+      if( write(_header.data(), _header.size(), _id.constData(), _id.size()) != _header.size() + _id.size() )
         return NotConnected;
       // wait for ready
       return waitForReady();
@@ -303,36 +326,72 @@ namespace Fkgo
       // write command: clear status
       if( write(CLEAR_STATUS) != 1 )
         return NotConnected;
-      // prepare erase all command sequence
-      QByteArray _seq;
-      {
-        _seq += ERASE;
-        _seq += ALL;
-      }
+      // erase all command sequence
+      static const char _seq[] = { char(ERASE), char(ALL) };
       // write command sequence
-      if( write(_seq) != _seq.size() )
+      if( write(_seq, sizeof(_seq)) != (qint64)sizeof(_seq) )
         return NotConnected;
       // wait for status
       return waitForReady();
     }
-    Connection::Status Connection::programPage( unsigned long _address, const QByteArray& _bytes )
+    Connection::Status Connection::eraseBlock( unsigned long _address )
     {
-      // prepare program page command sequence
-      QByteArray _seq;
-      {
-        // 32 bit address when remote side is R32C
-        if( device_ == R32C )
-        {
-          _seq += MSB;
-          _seq += (_address >> 24) & 0xff;
-        }
-        _seq += PROGRAM_PAGE;
-        _seq += (_address >> 8) & 0xff;
-        _seq += (_address >> 16) & 0xff;
-        _seq += _bytes;
-      }
+      qDebug() << "Connection::eraseBlock: erasing block at" << QString::number(_address,16);
+      // write command: clear status
+      if( write(CLEAR_STATUS) != 1 )
+        return NotConnected;
+      // encode for the current device
+      if( device_ == R32C )
+        return eraseBlockAs<R32C>(_address);
+      return eraseBlockAs<M16C>(_address);
+    }
+    template<Connection::Device D>
+    Connection::Status Connection::eraseBlockAs( unsigned long _address )
+    {
+      // command on the stack
+      const typename Command<D>::BlockErase _seq = Command<D>::blockErase(_address);
       // write command sequence
-      if( write(_seq) != _seq.size() )
+      if( write(_seq.data(), _seq.size()) != _seq.size() )
+        return NotConnected;
+      // wait for status
+      return waitForReady();
+    }
+    Connection::Status Connection::download( const QByteArray& _program )
+    {
+      qDebug() << "Connection::download: downloading" << _program.size() << "byte(s)";
+      // size is sent in 16 bits
+      if( _program.isEmpty() || _program.size() > 0xffff )
+        return ParameterError;
+      // checksum is the low byte of the sum of all program bytes
+      unsigned char _checksum = 0;
+      for( int i=0; i<_program.size(); ++i )
+        _checksum += _program[i];
+      // command header on the stack
+      const char _header[] = { char(DOWNLOAD), char(_program.size()), char(_program.size() >> 8), char(_checksum) };
+      // write command header and program
+      if( write(_header, sizeof(_header), _program.constData(), _program.size()) != (qint64)sizeof(_header) + _program.size() )
+        return NotConnected;
+      return Ready;
+    }
+    Connection::Status Connection::programPage( unsigned long _address, const QByteArray& _bytes )
+    {
+      Q_ASSERT(_bytes.size() == 0x100);
+      return programPage(_address, _bytes.constData());
+    }
+    Connection::Status Connection::programPage( unsigned long _address, const char* _bytes )
+    {
+      // encode for the current device
+      if( device_ == R32C )
+        return programPageAs<R32C>(_address, _bytes);
+      return programPageAs<M16C>(_address, _bytes);
+    }
+    template<Connection::Device D>
+    Connection::Status Connection::programPageAs( unsigned long _address, const char* _bytes )
+    {
+      // command header on the stack
+      const typename Command<D>::PageHeader _header = Command<D>::page(PROGRAM_PAGE, _address);
+      // write command header and page data
+      if( write(_header.data(), _header.size(), _bytes, 0x100) != _header.size() + 0x100 )
         return NotConnected;
       QThread::msleep(20);
       // wait for finish
@@ -360,44 +419,52 @@ namespace Fkgo
     }
     Connection::Status Connection::readPage( unsigned long _address, QByteArray& _bytes )
     {
-      // prepare request
-      QByteArray _seq;
-      {
-        if( device_ == R32C )
-        {
-          _seq += MSB;
-          _seq += (_address >> 24) & 0xff;
-        }
-        _seq += READ_PAGE;
-        _seq += (_address >> 8) & 0xff;
-        _seq += (_address >> 16) & 0xff;
-      }
+      _bytes.resize(0x100);
+      Status _status = readPage(_address, _bytes.data());
+      // do not hand out a partly filled page
+      if( Ready != _status )
+        _bytes.clear();
+      return _status;
+    }
+    Connection::Status Connection::readPage( unsigned long _address, char* _bytes )
+    {
+      // encode for the current device
+      if( device_ == R32C )
+        return readPageAs<R32C>(_address, _bytes);
+      return readPageAs<M16C>(_address, _bytes);
+    }
+    template<Connection::Device D>
+    Connection::Status Connection::readPageAs( unsigned long _address, char* _bytes )
+    {
+      // request on the stack
+      const typename Command<D>::PageHeader _header = Command<D>::page(READ_PAGE, _address);
       // write request sequence
-      if( write(_seq) != _seq.size() )
+      if( write(_header.data(), _header.size()) != _header.size() )
         return NotConnected;
-      // wait for the response data
-      for( int i=0; i<15; ++i )
+      // read the response data straight into the page
+      if( read(_bytes, 0x100, 15000) != 0x100 )
       {
-        _bytes = read(256);
-        if( _bytes.size() == 256 )
-          break;
-        // wait a 20th second
-        QThread::msleep(50);
+        qDebug() << "Connection::readPage: incomplete page";
+        return Timeout;
       }
       // brrrr...
       return status();
     }
-    qint64 Connection::write( const QByteArray& _bytes )
+    qint64 Connection::write( const char* _data, int _size )
+    {
+      return write(_data, _size, 0, 0);
+    }
+    qint64 Connection::write( const char* _head, int _headSize, const char* _body, int _bodySize )
     {
       // check if there is a port to write
-      if( 0 == port_ || !port_->isWritable() )
+      if( 0 == port_ || !port_->isOpen() )
         return NotConnected;
-      qDebug() << "Connection::write: writing" << _bytes.size() << "byte(s) =" << _bytes.toHex();
-      qint64 _written = port_->write(_bytes);
+      qDebug() << "Connection::write: writing" << _headSize + _bodySize << "byte(s) =" << QByteArray::fromRawData(_head, _headSize).toHex() << QByteArray::fromRawData(_body, _bodySize).toHex();
       // write given bytes to port
-      if( _written != _bytes.size() )
+      qint64 _written = _bodySize ? port_->write(_head, _headSize, _body, _bodySize) : port_->write(_head, _headSize);
+      if( _written != _headSize + _bodySize )
       {
-        qDebug() << "Connection::write: ERROR: Could only write" << _written << "of" << _bytes.size() << "byte(s)";
+        qDebug() << "Connection::write: ERROR: Could only write" << _written << "of" << _headSize + _bodySize << "byte(s)";
         // failed
         return _written;
       }
@@ -412,49 +479,54 @@ namespace Fkgo
     }
     qint64 Connection::write( char _byte )
     {
-      // pack byte into sequence
-      QByteArray _seq;
-      {
-        _seq += _byte;
-      }
-      // send byte
-      return write(_seq);
+      // send byte from the stack
+      return write(&_byte, 1);
     }
-    QByteArray Connection::read( int _count )
+    int Connection::read( char* _data, int _count, int _timeout )
     {
       Q_ASSERT(_count>0);
       // check if the port is open
       if( 0 == port_ )
       {
         qDebug() << "Connection::read: not connected";
-        return QByteArray();
+        return 0;
       }
       // check if port is readable
-      if( !port_->isReadable() )
+      if( !port_->isOpen() )
       {
         qDebug() << "Connection::read: not readable";
-        return QByteArray();
-      }
-      // wait 1 second for response
-      if( !port_->waitForReadyRead(1000) )
-      {
-        qDebug() << "Connection::read: timeout";
-        return QByteArray();
+        return 0;
       }
-      // read the requestes amount of bytes
-      QByteArray _result = port_->read(_count);
-      // retry to read bytes until complete or timeout 
-      for( int _i=0; _i<1000 && _result.size() < _count; ++_i )
+      // wait for the first byte, then give the rest 10 seconds to arrive
+      QElapsedTimer _timer;
+      _timer.start();
+      qint64 _deadline = _timeout;
+      int _received = 0;
+      while( _received < _count )
       {
-        port_->waitForReadyRead(10);
-        _result += port_->read(_count-_result.size());
+        // wait only if nothing is buffered yet
+        if( 0 == port_->bytesAvailable() )
+        {
+          qint64 _remaining = _deadline - _timer.elapsed();
+          if( _remaining <= 0 || !port_->waitForReadyRead(_remaining) )
+          {
+            qDebug() << "Connection::read: timeout";
+            break;
+          }
+        }
+        // read straight into the buffer
+        qint64 _read = port_->read(_data+_received, _count-_received);
+        if( _read < 0 )
+          break;
+        // extend deadline after the first byte arrived
+        if( 0 == _received && _read > 0 )
+          _deadline = _timer.elapsed() + 10000;
+        _received += _read;
       }
       // could not read enough bytes?
-      if( _result.size() != _count )
+      if( _received != _count )
         qDebug() << "Connection::read: could not read the requested number of bytes!";
-      // report
-      qDebug() << "Connection::read: read" << _result.size() << "/" << _count << "byte(s) =" << _result.toHex();
-      return _result;
+      return _received;
     }
   }
 }
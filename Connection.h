@@ -1,4 +1,8 @@
-#include <QSerialPort>
+#pragma once
+#include "Port.h"
+#include <QString>
+#include <QByteArray>
+#include <QVector>
 
 namespace Fkgo
 {
@@ -29,7 +33,9 @@ namespace Fkgo
         /// cannot open communication port
         CantOpenPort,
         /// no connection 
-        NotConnected
+        NotConnected,
+        /// loader program rejected a frame
+        TransferFailed
       };
       /// microcontroller type
       enum Device
@@ -39,6 +45,34 @@ namespace Fkgo
         M32C,
         R32C
       };
+      /// port backend
+      enum Backend
+      {
+        /// QSerialPort based backend
+        QtSerial,
+        /// native Linux termios backend
+        Native
+      };
+      /// step of a modem line sequence
+      struct LineStep
+      {
+        /// what the step does
+        enum Action
+        {
+          /// set DTR to value_
+          Dtr,
+          /// set RTS to value_
+          Rts,
+          /// wait value_ milliseconds
+          Wait
+        };
+        /// what the step does
+        Action action_;
+        /// line level or milliseconds
+        int value_;
+      };
+      /// modem line sequence (e.g. to reset the microcontroller into boot mode)
+      typedef QVector<LineStep> LineSequence;
 
       /// @brief create a connection
       Connection();
@@ -47,14 +81,33 @@ namespace Fkgo
       /** @brief open a connection
        * @param _portName name/path of the communictaion port
        * @param _device device type to communicate with
+       * @param _backend port backend to use
        */
-      void open( const QString& _portName, Device _device );
+      void open( const QString& _portName, Device _device, Backend _backend = QtSerial );
+      /** @brief open a connection through the given port backend
+       * @param _port port to use (will be owned by the connection)
+       * @param _device device type to communicate with
+       * @param _portName name of the port for messages
+       */
+      void open( Port* _port, Device _device, const QString& _portName = QString() );
       /// close existing connection
       void close();
+      /** @brief parse a modem line sequence
+       * @param _text comma separated steps dtr=0|1, rts=0|1 and wait=ms (e.g. "dtr=1,rts=1,wait=50,dtr=0,wait=100")
+       * @param _sequence receives the steps
+       * @return false if the text is invalid
+       */
+      static bool parseLineSequence( const QString& _text, LineSequence& _sequence );
+      /// play a modem line sequence and restart at 9600 baud
+      Status reset( const LineSequence& _sequence );
       /// initiate communication at low baud rate
       Status autoBaud();
       /// return currently used baud rate
-      QSerialPort::BaudRate baud() const;
+      qint32 baud() const;
+      /// return true if the port can run at the given baud rate
+      bool supportsBaudRate( qint32 _baud ) const;
+      /// change the baud rate of the port (after the remote side has switched)
+      bool setBaudRate( qint32 _baud );
       /// negotiate optimal baud rate
       Status baudRate();
       /// query version string from microcontroller
@@ -63,28 +116,55 @@ namespace Fkgo
       Status status();
       /// poll up to 16 tyimes for status until remote side reports Ready
       Status waitForReady();
-      /// unlock microcontroller with given ID
-      Status unlock(const QByteArray& _id );
+      /** @brief unlock microcontroller with given ID
+       * @param _id ID code
+       * @param _checkLocked poll the status first (false: caller knows the device is locked)
+       */
+      Status unlock(const QByteArray& _id, bool _checkLocked = true );
       /// erase user ROM of the microcontroller
       Status eraseAll();
+      /// erase the flash block containing the given address
+      Status eraseBlock( unsigned long _address );
+      /// download a program into RAM and run it
+      Status download( const QByteArray& _program );
       /// program a page ofe flash memory into the microcontroller
       Status programPage( unsigned long address, const QByteArray& _bytes );
+      /// program a page of 0x100 bytes without copying it
+      Status programPage( unsigned long _address, const char* _bytes );
       /// read a page of flash memory from the microcontroller
       Status readPage( unsigned long _address, QByteArray& _bytes );
+      /// read a page of 0x100 bytes straight into the given buffer
+      Status readPage( unsigned long _address, char* _bytes );
 
     protected:
       /// write multiple bytes to the microcontroller 
-      qint64 write( const QByteArray& _bytes );
+      qint64 write( const char* _data, int _size );
+      /// write a command header and its payload without joining them (scatter-gather)
+      qint64 write( const char* _head, int _headSize, const char* _body, int _bodySize );
       /// write a single byte to the microcontroller 
       qint64 write( char _byte );
-      /** @brief read what has been received from the microcontroller recently
-       * @param _count bytes to read 
+      /** @brief read exactly the given count of bytes straight into a buffer
+       * @param _data buffer to fill
+       * @param _count bytes to read
+       * @param _timeout milliseconds to wait for the first byte
+       * @return number of bytes read
        */
-      QByteArray read( int _count );
+      int read( char* _data, int _count, int _timeout = 1000 );
 
     private:
+      /// loader protocol reads and writes its frames through this connection
+      friend struct LoaderProtocol;
+      /// unlock using the command encoders of device D
+      template<Device D> Status unlockAs( const QByteArray& _id );
+      /// erase a block using the command encoders of device D
+      template<Device D> Status eraseBlockAs( unsigned long _address );
+      /// program a page using the command encoders of device D
+      template<Device D> Status programPageAs( unsigned long _address, const char* _bytes );
+      /// read a page using the command encoders of device D
+      template<Device D> Status readPageAs( unsigned long _address, char* _bytes );
+
       /// current communication port
-      QSerialPort *port_;
+      Port *port_;
       /// name of the current communication port
       QString portName_;
       /// current device type
@@ -0,0 +1,274 @@
+#include "DeltaPlan.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// return data of the page at the given address or 0 if it is blank or outside the image
+    static const char* pageData( const Image& _image, unsigned long _address )
+    {
+      if( !_image.contains(_address) )
+        return 0;
+      int _index = (_address - _image.start()) / Image::PageSize;
+      return _image.isBlank(_index) ? 0 : _image.page(_index).data_;
+    }
+    /// add big endian address to a hash
+    static void addAddress( QCryptographicHash& _hash, unsigned long _address )
+    {
+      const char _bytes[4] = { char(_address >> 24), char(_address >> 16), char(_address >> 8), char(_address) };
+      _hash.addData(_bytes, sizeof(_bytes));
+    }
+
+    DeltaPlan::DeltaPlan() :
+      device_(Connection::M16C)
+    {
+    }
+    DeltaPlan DeltaPlan::diff( Connection::Device _device, const Image& _base, const Image& _target )
+    {
+      DeltaPlan _plan;
+      _plan.device_ = _device;
+      _plan.baseHash_ = hash(_base);
+      _plan.targetHash_ = hash(_target);
+      // base pages which are gone or differ
+      for( Image::const_iterator _it = _base.begin(); _it != _base.end(); ++_it )
+      {
+        const Image::Page _page = *_it;
+        const char* _new = pageData(_target, _page.address_);
+        if( 0 == _new || 0 != memcmp(_new, _page.data_, Image::PageSize) )
+          _plan.pages_.append(_page.address_);
+      }
+      // pages which are new
+      for( Image::const_iterator _it = _target.begin(); _it != _target.end(); ++_it )
+      {
+        const Image::Page _page = *_it;
+        if( 0 == pageData(_base, _page.address_) )
+          _plan.pages_.append(_page.address_);
+      }
+      std::sort(_plan.pages_.begin(), _plan.pages_.end());
+      // expected contents of the changed pages on the device
+      QByteArray _contents(_plan.pages_.size() * Image::PageSize, char(0xff));
+      for( int i=0; i<_plan.pages_.size(); ++i )
+        if( const char* _old = pageData(_base, _plan.pages_[i]) )
+          memcpy(_contents.data() + i*Image::PageSize, _old, Image::PageSize);
+      _plan.checkHash_ = hash(_plan.pages_, _contents);
+      if( _plan.pages_.isEmpty() )
+        return _plan;
+      // blocks containing changed pages (both lists in ascending order)
+      QVector<DeviceModel::Block> _blocks = DeviceModel::blocks(_device, _plan.pages_.first());
+      std::reverse(_blocks.begin(), _blocks.end());
+      int _block = 0;
+      foreach( unsigned long _address, _plan.pages_ )
+      {
+        while( _block < _blocks.size() && _address - _blocks[_block].address_ >= _blocks[_block].size_ )
+          ++_block;
+        if( _block == _blocks.size() )
+        {
+          qDebug() << "DeltaPlan::diff: page outside of user ROM at" << QString::number(_address,16);
+          break;
+        }
+        if( _plan.blocks_.isEmpty() || _plan.blocks_.last().address_ != _blocks[_block].address_ )
+          _plan.blocks_.append(_blocks[_block]);
+      }
+      return _plan;
+    }
+    QByteArray DeltaPlan::hash( const Image& _image )
+    {
+      QCryptographicHash _hash(QCryptographicHash::Sha1);
+      for( Image::const_iterator _it = _image.begin(); _it != _image.end(); ++_it )
+      {
+        const Image::Page _page = *_it;
+        addAddress(_hash, _page.address_);
+        _hash.addData(_page.data_, Image::PageSize);
+      }
+      return _hash.result();
+    }
+    QByteArray DeltaPlan::hash( const QVector<unsigned long>& _pages, const QByteArray& _contents )
+    {
+      Q_ASSERT(_contents.size() == _pages.size() * Image::PageSize);
+      QCryptographicHash _hash(QCryptographicHash::Sha1);
+      for( int i=0; i<_pages.size(); ++i )
+      {
+        addAddress(_hash, _pages[i]);
+        _hash.addData(_contents.constData() + i*Image::PageSize, Image::PageSize);
+      }
+      return _hash.result();
+    }
+    bool DeltaPlan::save( const QString& _fileName ) const
+    {
+      QFile _file(_fileName);
+      if( !_file.open(QIODevice::WriteOnly | QIODevice::Text) )
+        return false;
+      QTextStream _out(&_file);
+      _out << "flash-renesas delta 1" << endl;
+      _out << "device " << device_ << endl;
+      _out << "base " << baseHash_.toHex() << endl;
+      _out << "target " << targetHash_.toHex() << endl;
+      _out << "check " << checkHash_.toHex() << endl;
+      foreach( const DeviceModel::Block& _block, blocks_ )
+        _out << "block " << QString::number(_block.address_,16) << " " << QString::number(_block.size_,16) << endl;
+      // runs of adjacent pages
+      for( int i=0; i<pages_.size(); )
+      {
+        int _count = 1;
+        while( i + _count < pages_.size() && pages_[i+_count] == pages_[i] + _count*Image::PageSize )
+          ++_count;
+        _out << "pages " << QString::number(pages_[i],16) << " " << _count << endl;
+        i += _count;
+      }
+      return QFile::NoError == _file.error();
+    }
+    bool DeltaPlan::load( const QString& _fileName )
+    {
+      QFile _file(_fileName);
+      if( !_file.open(QIODevice::ReadOnly | QIODevice::Text) )
+        return false;
+      QTextStream _in(&_file);
+      if( _in.readLine() != "flash-renesas delta 1" )
+      {
+        qDebug() << "DeltaPlan::load: not a delta plan" << _fileName;
+        return false;
+      }
+      *this = DeltaPlan();
+      while( !_in.atEnd() )
+      {
+        const QStringList _fields = _in.readLine().split(' ', QString::SkipEmptyParts);
+        if( _fields.isEmpty() )
+          continue;
+        bool ok = _fields.size() >= 2;
+        if( ok && "device" == _fields[0] )
+          device_ = (Connection::Device)_fields[1].toInt(&ok);
+        else if( ok && "base" == _fields[0] )
+          baseHash_ = QByteArray::fromHex(_fields[1].toLatin1());
+        else if( ok && "target" == _fields[0] )
+          targetHash_ = QByteArray::fromHex(_fields[1].toLatin1());
+        else if( ok && "check" == _fields[0] )
+          checkHash_ = QByteArray::fromHex(_fields[1].toLatin1());
+        else if( ok && "block" == _fields[0] && _fields.size() == 3 )
+        {
+          DeviceModel::Block _block;
+          bool _ok;
+          _block.address_ = _fields[1].toULong(&ok,16);
+          _block.size_ = _fields[2].toULong(&_ok,16);
+          ok = ok && _ok;
+          blocks_.append(_block);
+        }
+        else if( ok && "pages" == _fields[0] && _fields.size() == 3 )
+        {
+          bool _ok;
+          unsigned long _address = _fields[1].toULong(&ok,16);
+          int _count = _fields[2].toInt(&_ok);
+          ok = ok && _ok;
+          for( int i=0; ok && i<_count; ++i )
+            pages_.append(_address + i*Image::PageSize);
+        }
+        else
+          ok = false;
+        if( !ok )
+        {
+          qDebug() << "DeltaPlan::load: invalid line in" << _fileName;
+          return false;
+        }
+      }
+      // a stale or edited plan must not address anything outside of the device
+      if( device_ < Connection::R8C || device_ > Connection::R32C )
+      {
+        qDebug() << "DeltaPlan::load: unknown device" << device_;
+        return false;
+      }
+      foreach( const DeviceModel::Block& _block, blocks_ )
+      {
+        bool _known = false;
+        foreach( const DeviceModel::Block& _real, DeviceModel::blocks(device_, _block.address_) )
+          if( _real.address_ == _block.address_ && _real.size_ == _block.size_ )
+          {
+            _known = true;
+            break;
+          }
+        if( !_known )
+        {
+          qDebug() << "DeltaPlan::load: no such block" << QString::number(_block.address_,16) << QString::number(_block.size_,16);
+          return false;
+        }
+      }
+      foreach( unsigned long _address, pages_ )
+      {
+        bool _inside = 0 == (_address % Image::PageSize);
+        if( _inside )
+        {
+          _inside = false;
+          foreach( const DeviceModel::Block& _block, blocks_ )
+            if( _address >= _block.address_ && _address - _block.address_ < _block.size_ )
+            {
+              _inside = true;
+              break;
+            }
+        }
+        if( !_inside )
+        {
+          qDebug() << "DeltaPlan::load: page outside of the plan's blocks" << QString::number(_address,16);
+          return false;
+        }
+      }
+      return true;
+    }
+    void DeltaPlan::report( QTextStream& _out ) const
+    {
+      _out << "base: " << baseHash_.toHex() << endl;
+      _out << "target: " << targetHash_.toHex() << endl;
+      _out << "changed pages: " << pages_.size() << endl;
+      _out << "blocks to erase: " << blocks_.size() << endl;
+      foreach( const DeviceModel::Block& _block, blocks_ )
+        _out << "  " << QString::number(_block.address_,16) << " - " << QString::number(_block.address_ + (_block.size_ - 1),16) << " (" << _block.size_/1024 << "KB)" << endl;
+    }
+    Image DeltaPlan::restrict( const Image& _target ) const
+    {
+      if( _target.isEmpty() )
+        return _target;
+      // blank everything outside of the changed blocks
+      QByteArray _data(_target.size(), char(0xff));
+      foreach( const DeviceModel::Block& _block, blocks_ )
+      {
+        unsigned long _first = qMax(_block.address_, _target.start());
+        unsigned long _last = qMin(_block.address_ + (_block.size_ - 1), _target.endAddress() - 1);
+        if( _last < _first )
+          continue;
+        memcpy(_data.data() + (_first - _target.start()), _target.data().constData() + (_first - _target.start()), _last - _first + 1);
+      }
+      return Image(_target.start(), _data);
+    }
+    Connection::Device DeltaPlan::device() const
+    {
+      return device_;
+    }
+    const QByteArray& DeltaPlan::baseHash() const
+    {
+      return baseHash_;
+    }
+    const QByteArray& DeltaPlan::targetHash() const
+    {
+      return targetHash_;
+    }
+    const QByteArray& DeltaPlan::checkHash() const
+    {
+      return checkHash_;
+    }
+    const QVector<DeviceModel::Block>& DeltaPlan::blocks() const
+    {
+      return blocks_;
+    }
+    const QVector<unsigned long>& DeltaPlan::pages() const
+    {
+      return pages_;
+    }
+    bool DeltaPlan::isEmpty() const
+    {
+      return pages_.isEmpty();
+    }
+  }
+}
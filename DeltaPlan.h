@@ -0,0 +1,71 @@
+#pragma once
+#include "DeviceModel.h"
+#include "Image.h"
+#include <QTextStream>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /** @brief blocks and pages which differ between a base image and a new image
+     *
+     * A plan is made offline from two MOT files and applied later to a
+     * device which still holds the base image. Only the changed blocks are
+     * erased and only the new image's pages inside them are programmed.
+     * Before that the changed pages are read back and compared with the
+     * base through a hash, so the device is never read completely.
+     */
+    struct DeltaPlan
+    {
+    public:
+      /// create an empty plan
+      DeltaPlan();
+      /** @brief compare two images page by page
+       * @param _device device type (defines the erase blocks)
+       * @param _base image on the device
+       * @param _target new image
+       */
+      static DeltaPlan diff( Connection::Device _device, const Image& _base, const Image& _target );
+      /// return SHA-1 over addresses and contents of all non blank pages of an image
+      static QByteArray hash( const Image& _image );
+      /// return SHA-1 over the given pages as stored in the base image (hash of what is expected on the device)
+      static QByteArray hash( const QVector<unsigned long>& _pages, const QByteArray& _contents );
+      /// write plan into a text file
+      bool save( const QString& _fileName ) const;
+      /// read plan from a text file
+      bool load( const QString& _fileName );
+      /// write summary
+      void report( QTextStream& _out ) const;
+      /// return only the pages of an image which lie in the changed blocks
+      Image restrict( const Image& _target ) const;
+      /// return device type
+      Connection::Device device() const;
+      /// return hash of the base image
+      const QByteArray& baseHash() const;
+      /// return hash of the new image
+      const QByteArray& targetHash() const;
+      /// return hash of the changed pages in the base image
+      const QByteArray& checkHash() const;
+      /// return blocks to erase
+      const QVector<DeviceModel::Block>& blocks() const;
+      /// return addresses of the changed pages
+      const QVector<unsigned long>& pages() const;
+      /// return true if nothing has changed
+      bool isEmpty() const;
+
+    private:
+      /// device type
+      Connection::Device device_;
+      /// hash of the base image
+      QByteArray baseHash_;
+      /// hash of the new image
+      QByteArray targetHash_;
+      /// hash of the changed pages in the base image
+      QByteArray checkHash_;
+      /// blocks to erase in ascending order
+      QVector<DeviceModel::Block> blocks_;
+      /// changed pages in ascending order
+      QVector<unsigned long> pages_;
+    };
+  }
+}
@@ -0,0 +1,95 @@
+#include "DeviceModel.h"
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// block sizes from the top of user ROM downwards (0 repeats the last one)
+    static const unsigned long BlockSizes[] = { 0x1000, 0x1000, 0x2000, 0x2000, 0x2000, 0x8000, 0x10000, 0 };
+
+    unsigned long DeviceModel::top( Connection::Device _device )
+    {
+      switch( _device )
+      {
+      case Connection::R8C:
+        return 0xffff;
+      case Connection::M16C:
+        return 0xfffff;
+      case Connection::M32C:
+        return 0xffffff;
+      case Connection::R32C:
+      default:
+        return 0xffffffff;
+      }
+    }
+    QVector<DeviceModel::Block> DeviceModel::blocks( Connection::Device _device, unsigned long _lowest )
+    {
+      QVector<Block> _result;
+      // last address of the next block
+      unsigned long _last = top(_device);
+      for( int i=0; ; )
+      {
+        Block _block;
+        _block.size_ = BlockSizes[i];
+        _block.address_ = _last - _block.size_ + 1;
+        _result.append(_block);
+        // stop with the block containing the lowest address (or at address 0)
+        if( _block.address_ <= _lowest || _block.address_ == 0 )
+          break;
+        _last = _block.address_ - 1;
+        if( BlockSizes[i+1] )
+          ++i;
+      }
+      return _result;
+    }
+    int DeviceModel::eraseTime( const Block& _block )
+    {
+      // typical block erase times
+      if( _block.size_ <= 0x2000 )
+        return 300;
+      if( _block.size_ <= 0x8000 )
+        return 500;
+      return 800;
+    }
+    int DeviceModel::eraseTime( const QVector<Block>& _blocks )
+    {
+      int _result = 0;
+      foreach( const Block& _block, _blocks )
+        _result += eraseTime(_block);
+      return _result;
+    }
+    QVector<qint32> DeviceModel::baudRates()
+    {
+      QVector<qint32> _result;
+      _result << 9600 << 19200 << 38400 << 57600 << 115200;
+      return _result;
+    }
+    double DeviceModel::connectTime()
+    {
+      // autoBaud: 3 ms plus 16 null bytes every 40 ms
+      return 3 + 16*40;
+    }
+    /// return milliseconds to transfer the given number of bytes
+    static double transferTime( int _bytes, qint32 _baud )
+    {
+      return _bytes * 10 * 1000.0 / _baud;
+    }
+    /// return bytes of a page command header
+    static int headerSize( Connection::Device _device )
+    {
+      return Connection::R32C == _device ? 5 : 3;
+    }
+    double DeviceModel::programTime( Connection::Device _device, qint32 _baud, double _latency )
+    {
+      // command and page data, fixed delay of Connection::programPage, status request and response
+      return transferTime(headerSize(_device) + 0x100, _baud) + 20
+           + transferTime(1 + 2, _baud) + _latency;
+    }
+    double DeviceModel::verifyTime( Connection::Device _device, qint32 _baud, double _latency )
+    {
+      // request and page data, status request and response
+      return transferTime(headerSize(_device) + 0x100, _baud) + _latency
+           + transferTime(1 + 2, _baud) + _latency;
+    }
+  }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "Connection.h"
+#include <QVector>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /** @brief flash layout and timing of the microcontrollers
+     *
+     * Block layout and timings follow the M16C/62P family (blocks of
+     * 4K, 4K, 8K, 8K, 8K, 32K and then 64K from the top of the user ROM
+     * downwards). The other device families are approximated with it.
+     * Transfer times assume 10 bits per byte (8N1).
+     */
+    struct DeviceModel
+    {
+    public:
+      /// an erase block
+      struct Block
+      {
+        /// first address of the block
+        unsigned long address_;
+        /// size of the block in bytes
+        unsigned long size_;
+      };
+      /// return last address of the user ROM of the given device
+      static unsigned long top( Connection::Device _device );
+      /** @brief return erase blocks from the top of user ROM down to the given address
+       * @param _device device type
+       * @param _lowest lowest address to be covered by the blocks
+       */
+      static QVector<Block> blocks( Connection::Device _device, unsigned long _lowest );
+      /// return typical erase time of a block in milliseconds
+      static int eraseTime( const Block& _block );
+      /// return typical erase time of the given blocks in milliseconds
+      static int eraseTime( const QVector<Block>& _blocks );
+      /// return baud rates the boot ROM can negotiate
+      static QVector<qint32> baudRates();
+      /// return typical time from autoBaud to version in milliseconds
+      static double connectTime();
+      /** @brief return estimated time to program one page in milliseconds
+       * @param _device device type
+       * @param _baud baud rate
+       * @param _latency turnaround time of the adapter per response in milliseconds
+       */
+      static double programTime( Connection::Device _device, qint32 _baud, double _latency );
+      /** @brief return estimated time to read back one page in milliseconds
+       * @param _device device type
+       * @param _baud baud rate
+       * @param _latency turnaround time of the adapter per response in milliseconds
+       */
+      static double verifyTime( Connection::Device _device, qint32 _baud, double _latency );
+    };
+  }
+}
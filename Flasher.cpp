@@ -0,0 +1,402 @@
+#include "Flasher.h"
+#include "IdCode.h"
+#include "BlankCheck.h"
+#include "Analysis.h"
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QMutex>
+#include <QDebug>
+#include <cstring>
+
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// serializes output of concurrent flashers
+    static QMutex outputMutex;
+
+    /// render a progress bar
+    static QString progress( int _cur, int _max, int _len )
+    {
+      int _step = _max/_len;
+      return QString() + "[" + QString(_cur/_step+1,'#') + QString(_max/_step-_cur/_step-1,'.') + "] " + QString::number(100*_cur/_max+1) + "%";
+    }
+
+    Flasher::Options::Options() :
+      device_(Connection::M16C),
+      blankCheck_(0),
+      verify_(false),
+      progress_(false),
+      loaderBaud_(0),
+      retries_(0),
+      measure_(true)
+    {
+    }
+    Flasher::Flasher( Connection& _connection, const Options& _options, const QString& _prefix ) :
+      connection_(_connection),
+      options_(_options),
+      prefix_(_prefix),
+      eraseReport_("none"),
+      loader_(0)
+    {
+    }
+    Flasher::~Flasher()
+    {
+      delete loader_;
+    }
+    Flasher::Result Flasher::connect()
+    {
+      // reset into boot mode
+      if( !options_.resetSequence_.isEmpty() && Connection::Ready != connection_.reset(options_.resetSequence_) )
+        return CannotConnect;
+      // connect to the microcontroller
+      if( Connection::Ready != connection_.autoBaud() )
+        return CannotConnect;
+      if( Connection::Ready != connection_.baudRate() )
+        return BaudRateFailed;
+      message("negotiated baud rate: " + QString::number(connection_.baud()));
+      // get version
+      QString _version;
+      if( Connection::Ready != connection_.version(_version) )
+        return VersionFailed;
+      message("remote version: " + _version);
+      return Passed;
+    }
+    Flasher::Result Flasher::unlock( const Image& _image )
+    {
+      // nothing to send (and nothing to remember) if the device is not locked
+      const Connection::Status _locked = connection_.status();
+      if( Connection::NotConnected == _locked || Connection::Timeout == _locked )
+        return UnlockFailed;
+      if( Connection::Locked != _locked )
+      {
+        id_.clear();
+        message("not locked");
+        return Passed;
+      }
+      // unlock the microcontroller with the given ID
+      if( !options_.id_.isEmpty() )
+      {
+        id_ = options_.id_;
+        if( Connection::Ready != connection_.unlock(id_, false) )
+          return UnlockFailed;
+      }
+      else
+      {
+        Connection::Status _status = Connection::Locked;
+        foreach( const QByteArray& _candidate, IdCode::candidates(options_.device_, _image) )
+        {
+          id_ = _candidate;
+          // the status after each attempt tells if the device is still locked
+          _status = connection_.unlock(id_, false);
+          // stop trying if the ID fits or on any other failure
+          if( Connection::Locked != _status )
+            break;
+        }
+        if( Connection::Ready != _status )
+          return UnlockFailed;
+        if( !_image.isEmpty() )
+          IdCode::remember(_image, id_);
+      }
+      message("unlocked with: " + id_.toHex());
+      return Passed;
+    }
+    Flasher::Result Flasher::erase( const Image& _image )
+    {
+      // find blocks which need to be erased (needs the whole image)
+      if( options_.blankCheck_ > 0 && !_image.isEmpty() )
+      {
+        QElapsedTimer _timer;
+        _timer.start();
+        message("checking for blank blocks...");
+        const QVector<DeviceModel::Block> _blocks = DeviceModel::blocks(options_.device_, _image.start());
+        QVector<DeviceModel::Block> _dirty;
+        if( Connection::Ready != BlankCheck(connection_, options_.blankCheck_, _image).check(_blocks, _dirty) )
+          return BlankCheckFailed;
+        // erase only what is not blank
+        foreach( const DeviceModel::Block& _block, _dirty )
+        {
+          message("erasing block at " + QString::number(_block.address_,16) + "...");
+          if( Connection::Ready != connection_.eraseBlock(_block.address_) )
+            return EraseFailed;
+        }
+        // estimated time of erasing all blocks minus what has actually been spent
+        eraseReport_ = QString("erased %1 of %2 block(s), saved ~%3 ms")
+          .arg(_dirty.size()).arg(_blocks.size())
+          .arg(DeviceModel::eraseTime(_blocks) - _timer.elapsed());
+        message("blank check: " + eraseReport_);
+      }
+      else
+      {
+        // eraseAll
+        message("erasing flash memory...");
+        if( Connection::Ready != connection_.eraseAll() )
+          return EraseFailed;
+        eraseReport_ = "erased all";
+      }
+      return Passed;
+    }
+    Flasher::Result Flasher::checkBase( const DeltaPlan& _plan )
+    {
+      message("checking " + QString::number(_plan.pages().size()) + " changed page(s) against base " + _plan.baseHash().toHex().left(8) + "...");
+      QByteArray _contents(_plan.pages().size() * Image::PageSize, char(0xff));
+      for( int i=0; i<_plan.pages().size(); ++i )
+        if( Connection::Ready != connection_.readPage(_plan.pages()[i], _contents.data() + i*Image::PageSize) )
+          return BlankCheckFailed;
+      if( DeltaPlan::hash(_plan.pages(), _contents) != _plan.checkHash() )
+        return BaseMismatch;
+      return Passed;
+    }
+    Flasher::Result Flasher::erase( const DeltaPlan& _plan )
+    {
+      foreach( const DeviceModel::Block& _block, _plan.blocks() )
+      {
+        message("erasing block at " + QString::number(_block.address_,16) + "...");
+        if( Connection::Ready != connection_.eraseBlock(_block.address_) )
+          return EraseFailed;
+      }
+      eraseReport_ = QString("erased %1 changed block(s)").arg(_plan.blocks().size());
+      return Passed;
+    }
+    Flasher::Result Flasher::startLoader()
+    {
+      if( options_.loader_.isEmpty() || 0 != loader_ )
+        return Passed;
+      message("starting loader (" + QString::number(options_.loader_.size()) + " bytes)...");
+      loader_ = new LoaderProtocol(connection_);
+      if( Connection::Ready != loader_->start(options_.loader_) )
+        return LoaderFailed;
+      // switch to the loader's bit rate
+      if( options_.loaderBaud_ > 0 )
+      {
+        if( Connection::Ready != loader_->setBaudRate(options_.loaderBaud_) )
+          return LoaderFailed;
+        message("loader baud rate: " + QString::number(options_.loaderBaud_));
+      }
+      return Passed;
+    }
+    Flasher::Result Flasher::program( const Image& _image )
+    {
+      if( 0 != loader_ )
+        return programThroughLoader(_image);
+      message("Writing image from " + QString::number(_image.start(),16) + " to " + QString::number(_image.endAddress()-1,16) + " = " + QString::number(_image.size()/1024) + "KB");
+      QElapsedTimer _timer;
+      _timer.start();
+      for( Image::const_iterator _it = _image.begin(); _it != _image.end(); ++_it )
+      {
+        const Image::Page _page = *_it;
+        if( options_.progress_ )
+        {
+          QMutexLocker _lock(&outputMutex);
+          QTextStream(stdout) << "\rWriting page at address " << QString::number(_page.address_,16) << " " << progress(_it.index()*Image::PageSize,_image.size(),60) << "     \b\b\b\b" << flush;
+        }
+        // program current page
+        if( Connection::Ready != connection_.programPage( _page.address_, _page.data_ ) )
+          return ProgramFailed;
+      }
+      if( options_.progress_ )
+        message("");
+      // keep measured time per page for flash time estimates
+      if( options_.measure_ && _image.relevantCount() > 0 )
+        Analysis::remember(options_.device_, connection_.baud(), "program", (double)_timer.elapsed() / _image.relevantCount());
+      message(QString::number(_image.relevantCount()) + " relevant pages = " + QString::number((_image.relevantCount()*Image::PageSize)/1024) + "KB");
+      return Passed;
+    }
+    Flasher::Result Flasher::programThroughLoader( const Image& _image )
+    {
+      message("Writing image from " + QString::number(_image.start(),16) + " to " + QString::number(_image.endAddress()-1,16) + " = " + QString::number(_image.size()/1024) + "KB through loader");
+      QElapsedTimer _timer;
+      _timer.start();
+      // pages of a run are adjacent in the image data
+      unsigned long _address = 0;
+      const char* _data = 0;
+      int _size = 0;
+      for( Image::const_iterator _it = _image.begin(); ; ++_it )
+      {
+        const bool _end = !(_it != _image.end());
+        // send the current run when it cannot be extended
+        if( _size > 0 && ( _end || (*_it).address_ != _address + _size || _size == LoaderProtocol::MaxBlock ) )
+        {
+          if( options_.progress_ )
+          {
+            QMutexLocker _lock(&outputMutex);
+            QTextStream(stdout) << "\rWriting block at address " << QString::number(_address,16) << " " << progress(_address + _size - _image.start() - 1,_image.size(),60) << "     \b\b\b\b" << flush;
+          }
+          if( Connection::Ready != loader_->write(_address, _data, _size) )
+            return ProgramFailed;
+          _size = 0;
+        }
+        if( _end )
+          break;
+        const Image::Page _page = *_it;
+        if( 0 == _size )
+        {
+          _address = _page.address_;
+          _data = _page.data_;
+        }
+        _size += Image::PageSize;
+      }
+      // wait for the last frames
+      if( Connection::Ready != loader_->flush() )
+        return ProgramFailed;
+      if( options_.progress_ )
+        message("");
+      // keep measured time per page apart from the boot ROM timings
+      if( options_.measure_ && _image.relevantCount() > 0 )
+        Analysis::remember(options_.device_, connection_.baud(), "loader-program", (double)_timer.elapsed() / _image.relevantCount());
+      message(QString::number(_image.relevantCount()) + " relevant pages = " + QString::number((_image.relevantCount()*Image::PageSize)/1024) + "KB");
+      return Passed;
+    }
+    Flasher::Result Flasher::verifyThroughLoader( const Image& _image )
+    {
+      QElapsedTimer _timer;
+      _timer.start();
+      char _read[LoaderProtocol::MaxBlock];
+      Image::const_iterator _it = _image.begin();
+      while( _it != _image.end() )
+      {
+        // collect a run of adjacent pages
+        const Image::Page _first = *_it;
+        int _size = 0;
+        do
+        {
+          _size += Image::PageSize;
+          ++_it;
+        }
+        while( _it != _image.end() && _size < LoaderProtocol::MaxBlock && (*_it).address_ == _first.address_ + _size );
+        if( Connection::Ready != loader_->read(_first.address_, _read, _size)
+            || 0 != memcmp(_read, _first.data_, _size) )
+        {
+          message("verification failed in block at " + QString::number(_first.address_,16));
+          return VerifyFailed;
+        }
+      }
+      // keep measured time per page apart from the boot ROM timings
+      if( options_.measure_ && _image.relevantCount() > 0 )
+        Analysis::remember(options_.device_, connection_.baud(), "loader-verify", (double)_timer.elapsed() / _image.relevantCount());
+      return Passed;
+    }
+    Flasher::Result Flasher::verify( const Image& _image )
+    {
+      if( 0 != loader_ )
+      {
+        message("verifying through loader...");
+        return verifyThroughLoader(_image);
+      }
+      message("verifying...");
+      QElapsedTimer _timer;
+      _timer.start();
+      char _read[Image::PageSize];
+      for( Image::const_iterator _it = _image.begin(); _it != _image.end(); ++_it )
+      {
+        const Image::Page _page = *_it;
+        if( Connection::Ready != connection_.readPage(_page.address_, _read)
+            || 0 != memcmp(_read, _page.data_, Image::PageSize) )
+        {
+          message("verification failed at " + QString::number(_page.address_,16));
+          return VerifyFailed;
+        }
+      }
+      // keep measured time per page for flash time estimates
+      if( options_.measure_ && _image.relevantCount() > 0 )
+        Analysis::remember(options_.device_, connection_.baud(), "verify", (double)_timer.elapsed() / _image.relevantCount());
+      return Passed;
+    }
+    Flasher::Result Flasher::retry( const std::function<Result()>& _steps )
+    {
+      for( int _attempt = 0; ; ++_attempt )
+      {
+        Result _result = _steps();
+        if( Passed == _result || !retryable(_result) || _attempt >= options_.retries_ )
+          return _result;
+        message(toString(_result) + ", retrying (" + QString::number(_attempt+1) + "/" + QString::number(options_.retries_) + ")...");
+        // the reset ends a running loader
+        delete loader_;
+        loader_ = 0;
+      }
+    }
+    Flasher::Result Flasher::run( const Image& _image )
+    {
+      return retry([&]() -> Result
+      {
+        Result _result = connect();
+        if( Passed == _result )
+          _result = unlock(_image);
+        if( Passed == _result )
+          _result = erase(_image);
+        if( Passed == _result )
+          _result = startLoader();
+        if( Passed == _result )
+          _result = program(_image);
+        if( Passed == _result && options_.verify_ )
+          _result = verify(_image);
+        return _result;
+      });
+    }
+    bool Flasher::retryable( Result _result )
+    {
+      switch( _result )
+      {
+      case CannotConnect:
+      case BaudRateFailed:
+      case VersionFailed:
+      case UnlockFailed:
+      case EraseFailed:
+      case ProgramFailed:
+      case VerifyFailed:
+      case LoaderFailed:
+        return true;
+      default:
+        return false;
+      }
+    }
+    const QByteArray& Flasher::id() const
+    {
+      return id_;
+    }
+    const QString& Flasher::eraseReport() const
+    {
+      return eraseReport_;
+    }
+    QString Flasher::toString( Result _result )
+    {
+      switch( _result )
+      {
+      case Passed:
+        return "passed";
+      case CannotConnect:
+        return "cannot connect";
+      case BaudRateFailed:
+        return "cannot negotiate baud rate";
+      case VersionFailed:
+        return "cannot get version";
+      case UnlockFailed:
+        return "unlocking failed";
+      case BlankCheckFailed:
+        return "blank check failed";
+      case EraseFailed:
+        return "erasing flash memory failed";
+      case ProgramFailed:
+        return "programming page failed";
+      case VerifyFailed:
+        return "verifying flash memory failed";
+      case LoaderFailed:
+        return "loader did not start";
+      case BaseMismatch:
+        return "device does not hold the base image of the plan";
+      default:
+        return "unknown error";
+      }
+    }
+    void Flasher::message( const QString& _text ) const
+    {
+      print(prefix_ + _text);
+    }
+    void Flasher::print( const QString& _text )
+    {
+      QMutexLocker _lock(&outputMutex);
+      QTextStream(stdout) << _text << endl;
+    }
+  }
+}
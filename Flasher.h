@@ -0,0 +1,134 @@
+#pragma once
+#include "Connection.h"
+#include "Image.h"
+#include "LoaderProtocol.h"
+#include "DeltaPlan.h"
+#include <QString>
+#include <functional>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// runs the steps to flash an image through a connection
+    struct Flasher
+    {
+    public:
+      /// result of a step
+      enum Result
+      {
+        /// step succeeded
+        Passed,
+        /// no connection to the microcontroller
+        CannotConnect,
+        /// no response at 9600 baud
+        BaudRateFailed,
+        /// version could not be read
+        VersionFailed,
+        /// none of the IDs unlocked the microcontroller
+        UnlockFailed,
+        /// pages could not be read for the blank check or the base check
+        BlankCheckFailed,
+        /// erase failed
+        EraseFailed,
+        /// programming a page failed
+        ProgramFailed,
+        /// read back differs from the image
+        VerifyFailed,
+        /// loader program did not start
+        LoaderFailed,
+        /// device does not hold the base image of a delta plan
+        BaseMismatch
+      };
+      /// flash options
+      struct Options
+      {
+        /// set defaults
+        Options();
+        /// device type
+        Connection::Device device_;
+        /// ID to unlock with (empty: try IDs from IdCode::candidates())
+        QByteArray id_;
+        /// blank check every n-th page instead of erasing all (0: erase all)
+        int blankCheck_;
+        /// read back programmed pages
+        bool verify_;
+        /// show a progress bar while programming
+        bool progress_;
+        /// RAM loader program to program and verify through (empty: use boot ROM)
+        QByteArray loader_;
+        /// baud rate to switch the loader to (0: keep)
+        qint32 loaderBaud_;
+        /// modem line sequence which resets into boot mode before connecting (empty: none)
+        Connection::LineSequence resetSequence_;
+        /// number of times failed steps are repeated from connecting on
+        int retries_;
+        /// remember step timings for --analyze (off for simulated and replayed devices)
+        bool measure_;
+      };
+
+      /** @brief create a flasher
+       * @param _connection open connection to the microcontroller
+       * @param _options flash options
+       * @param _prefix prefix for all messages (e.g. port name)
+       */
+      Flasher( Connection& _connection, const Options& _options, const QString& _prefix = QString() );
+      /// stop using the loader
+      ~Flasher();
+      /// negotiate baud rate and read version
+      Result connect();
+      /// unlock the microcontroller (image is used to find the ID and may be empty)
+      Result unlock( const Image& _image );
+      /// erase all or only the non blank blocks covered by the image
+      Result erase( const Image& _image );
+      /// read back the changed pages of a delta plan and compare them with its base image
+      Result checkBase( const DeltaPlan& _plan );
+      /// erase the blocks of a delta plan
+      Result erase( const DeltaPlan& _plan );
+      /// download and start the loader program if there is one (boot ROM commands are unavailable afterwards)
+      Result startLoader();
+      /// program all non blank pages of the image
+      Result program( const Image& _image );
+      /// read back and compare all non blank pages of the image
+      Result verify( const Image& _image );
+      /** @brief run steps and repeat them on failures up to the configured retries
+       * @param _steps steps to run starting with connect()
+       * @return result of the last attempt
+       */
+      Result retry( const std::function<Result()>& _steps );
+      /// run all steps
+      Result run( const Image& _image );
+      /// return true if repeating the steps may cure the given failure
+      static bool retryable( Result _result );
+      /// return ID which unlocked the microcontroller
+      const QByteArray& id() const;
+      /// return description of the erase decision
+      const QString& eraseReport() const;
+      /// return description of a result
+      static QString toString( Result _result );
+      /// print a message line with the flasher's prefix (thread safe)
+      void message( const QString& _text ) const;
+      /// print a line (thread safe)
+      static void print( const QString& _text );
+
+    private:
+      /// program contiguous non blank pages in large frames through the loader
+      Result programThroughLoader( const Image& _image );
+      /// read back in large frames through the loader
+      Result verifyThroughLoader( const Image& _image );
+
+      /// connection to the microcontroller
+      Connection& connection_;
+      /// flash options
+      Options options_;
+      /// message prefix
+      QString prefix_;
+      /// ID which unlocked the microcontroller
+      QByteArray id_;
+      /// erase decision
+      QString eraseReport_;
+      /// running loader protocol (0: boot ROM)
+      LoaderProtocol* loader_;
+    };
+  }
+}
@@ -0,0 +1,78 @@
+#include "IdCode.h"
+#include <QCryptographicHash>
+#include <QSettings>
+#include <QDebug>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// offsets of the ID code bytes relative to the first one (most significant byte of a vector each)
+    static const unsigned long Offsets[IdCode::Size] = { 0x00, 0x04, 0x0C, 0x10, 0x14, 0x18, 0x1C };
+
+    /// return settings key for the given image
+    static QString cacheKey( const Image& _image )
+    {
+      return "unlock/" + QCryptographicHash::hash(_image.data(), QCryptographicHash::Sha1).toHex();
+    }
+
+    unsigned long IdCode::address( Connection::Device _device )
+    {
+      switch( _device )
+      {
+      case Connection::R8C:
+        return 0x00ffdf;
+      case Connection::M16C:
+        return 0x0fffdf;
+      case Connection::M32C:
+        return 0xffffdf;
+      case Connection::R32C:
+        return 0xffffffdf;
+      default:
+        return 0;
+      }
+    }
+    QByteArray IdCode::fromImage( Connection::Device _device, const Image& _image )
+    {
+      unsigned long _address = address(_device);
+      // check if ID code area is part of the image
+      if( !_image.contains(_address) || !_image.contains(_address + Offsets[Size-1]) )
+        return QByteArray();
+      // collect ID bytes
+      QByteArray _id;
+      for( int i=0; i<Size; ++i )
+        _id += _image.at(_address + Offsets[i]);
+      qDebug() << "IdCode::fromImage: found" << _id.toHex();
+      return _id;
+    }
+    QByteArray IdCode::cached( const Image& _image )
+    {
+      QSettings _settings("fkgo", "flash-renesas");
+      QByteArray _id = QByteArray::fromHex(_settings.value(cacheKey(_image)).toByteArray());
+      // ignore broken entries
+      if( _id.size() != Size )
+        return QByteArray();
+      return _id;
+    }
+    void IdCode::remember( const Image& _image, const QByteArray& _id )
+    {
+      QSettings _settings("fkgo", "flash-renesas");
+      _settings.setValue(cacheKey(_image), _id.toHex());
+    }
+    QList<QByteArray> IdCode::candidates( Connection::Device _device, const Image& _image )
+    {
+      QList<QByteArray> _result;
+      _result << fromImage(_device, _image)
+              << cached(_image)
+              << QByteArray(Size, 0x00)
+              << QByteArray(Size, 0xff);
+      // drop unknown and duplicate IDs
+      _result.removeAll(QByteArray());
+      for( int i=0; i<_result.size(); ++i )
+        for( int j=_result.size()-1; j>i; --j )
+          if( _result[j] == _result[i] )
+            _result.removeAt(j);
+      return _result;
+    }
+  }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "Connection.h"
+#include "Image.h"
+#include <QList>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// ID code used to unlock the microcontroller
+    struct IdCode
+    {
+    public:
+      /// count of bytes in an ID code
+      enum { Size = 7 };
+      /// return address of the first ID code byte for the given device or 0 if unknown
+      static unsigned long address( Connection::Device _device );
+      /** @brief extract ID code out of the fixed vector table of an image
+       * @param _device device type the image is made for
+       * @param _image image to search
+       * @return ID code or empty array if the image does not contain it
+       */
+      static QByteArray fromImage( Connection::Device _device, const Image& _image );
+      /// return the ID which unlocked a device programmed with the given image before
+      static QByteArray cached( const Image& _image );
+      /// remember that the given ID unlocked a device for the given image
+      static void remember( const Image& _image, const QByteArray& _id );
+      /// return IDs to try in order: from image, from cache and the defaults
+      static QList<QByteArray> candidates( Connection::Device _device, const Image& _image );
+    };
+  }
+}
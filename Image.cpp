@@ -0,0 +1,200 @@
+#include "Image.h"
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    Image::const_iterator::const_iterator( const Image* _image, int _index ) :
+      image_(_image),
+      index_(_index)
+    {
+      // skip leading blank pages
+      while( index_ < image_->pageCount() && image_->isBlank(index_) )
+        ++index_;
+    }
+    Image::Page Image::const_iterator::operator*() const
+    {
+      return image_->page(index_);
+    }
+    Image::const_iterator& Image::const_iterator::operator++()
+    {
+      // skip blank pages
+      do
+        ++index_;
+      while( index_ < image_->pageCount() && image_->isBlank(index_) );
+      return *this;
+    }
+    bool Image::const_iterator::operator!=( const const_iterator& _other ) const
+    {
+      return index_ != _other.index_;
+    }
+    int Image::const_iterator::index() const
+    {
+      return index_;
+    }
+
+    Image::Image() :
+      start_(0),
+      relevant_(0)
+    {
+    }
+    Image::Image( unsigned long _start, const QByteArray& _data, const QVector<Range>& _ranges ) :
+      start_(_start),
+      data_(_data),
+      ranges_(_ranges),
+      blank_(_data.size() / PageSize),
+      relevant_(0)
+    {
+      Q_ASSERT(_start % PageSize == 0 && _data.size() % PageSize == 0);
+      // without any record information the whole image counts
+      if( ranges_.isEmpty() && !data_.isEmpty() )
+      {
+        Range _range = { start_, (unsigned long)data_.size() };
+        ranges_.append(_range);
+      }
+      // scan pages once
+      for( int i=0; i<blank_.size(); ++i )
+      {
+        bool _blank = isBlank(data_.constData() + i*PageSize, PageSize);
+        blank_.setBit(i, _blank);
+        if( !_blank )
+          ++relevant_;
+      }
+    }
+    unsigned long Image::start() const
+    {
+      return start_;
+    }
+    unsigned long Image::endAddress() const
+    {
+      return start_ + data_.size();
+    }
+    const QByteArray& Image::data() const
+    {
+      return data_;
+    }
+    int Image::size() const
+    {
+      return data_.size();
+    }
+    bool Image::isEmpty() const
+    {
+      return data_.isEmpty();
+    }
+    int Image::pageCount() const
+    {
+      return blank_.size();
+    }
+    int Image::relevantCount() const
+    {
+      return relevant_;
+    }
+    bool Image::isBlank( int _index ) const
+    {
+      return blank_.testBit(_index);
+    }
+    Image::Page Image::page( int _index ) const
+    {
+      Page _page = { start_ + _index*PageSize, data_.constData() + _index*PageSize };
+      return _page;
+    }
+    bool Image::contains( unsigned long _address ) const
+    {
+      return _address >= start_ && _address < endAddress();
+    }
+    char Image::at( unsigned long _address ) const
+    {
+      Q_ASSERT(contains(_address));
+      return data_.constData()[_address - start_];
+    }
+    Image::const_iterator Image::begin() const
+    {
+      return const_iterator(this, 0);
+    }
+    Image::const_iterator Image::end() const
+    {
+      return const_iterator(this, pageCount());
+    }
+    const QVector<Image::Range>& Image::ranges() const
+    {
+      return ranges_;
+    }
+    /// order ranges by address
+    static bool lessThan( const Image::Range& _a, const Image::Range& _b )
+    {
+      return _a.address_ < _b.address_;
+    }
+    bool Image::merge( const QVector<Image>& _images, const QVector<long>& _offsets, Image& _result, unsigned long& _conflict )
+    {
+      Q_ASSERT(_images.size() == _offsets.size());
+      // collect moved ranges of all images
+      QVector<Range> _ranges;
+      for( int i=0; i<_images.size(); ++i )
+        foreach( Range _range, _images[i].ranges() )
+        {
+          _range.address_ += _offsets[i];
+          _ranges.append(_range);
+        }
+      if( _ranges.isEmpty() )
+      {
+        _result = Image();
+        return true;
+      }
+      // check for overlaps
+      std::sort(_ranges.begin(), _ranges.end(), lessThan);
+      for( int i=1; i<_ranges.size(); ++i )
+        if( _ranges[i].address_ < _ranges[i-1].address_ + _ranges[i-1].size_ )
+        {
+          _conflict = _ranges[i].address_;
+          return false;
+        }
+      // page aligned bounds of the merged image
+      unsigned long _start = _ranges.first().address_ - _ranges.first().address_ % PageSize;
+      unsigned long _end = 0;
+      foreach( const Range& _range, _ranges )
+        _end = qMax(_end, _range.address_ + _range.size_);
+      _end += (PageSize - _end % PageSize) % PageSize;
+      // copy filled ranges into a blank image
+      QByteArray _data(_end - _start, 0xff);
+      for( int i=0; i<_images.size(); ++i )
+        foreach( const Range& _range, _images[i].ranges() )
+          memcpy(_data.data() + (_range.address_ + _offsets[i] - _start), _images[i].data().constData() + (_range.address_ - _images[i].start()), _range.size_);
+      _result = Image(_start, _data, _ranges);
+      return true;
+    }
+    bool Image::isBlank( const char* _data, int _size )
+    {
+      int i = 0;
+#ifdef __SSE2__
+      // AND 16 bytes at once and compare the result against all ones
+      const __m128i _ones = _mm_set1_epi8(-1);
+      __m128i _acc = _ones;
+      for( ; i+16 <= _size; i += 16 )
+        _acc = _mm_and_si128(_acc, _mm_loadu_si128((const __m128i*)(_data + i)));
+      if( _mm_movemask_epi8(_mm_cmpeq_epi8(_acc, _ones)) != 0xffff )
+        return false;
+#else
+      // AND machine words
+      quint64 _acc = ~(quint64)0;
+      for( ; i+8 <= _size; i += 8 )
+      {
+        quint64 _word;
+        memcpy(&_word, _data + i, 8);
+        _acc &= _word;
+      }
+      if( _acc != ~(quint64)0 )
+        return false;
+#endif
+      // remaining bytes
+      for( ; i < _size; ++i )
+        if( (unsigned char)_data[i] != 0xff )
+          return false;
+      return true;
+    }
+  }
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <QByteArray>
+#include <QBitArray>
+#include <QVector>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// flash image made of pages with a bitmap of blank pages
+    struct Image
+    {
+    public:
+      /// size of a flash page
+      enum { PageSize = 0x100 };
+
+      /// address range which has been filled by records
+      struct Range
+      {
+        /// first address
+        unsigned long address_;
+        /// number of bytes
+        unsigned long size_;
+      };
+
+      /// view of a page inside the image (no copy)
+      struct Page
+      {
+        /// flash address of the page
+        unsigned long address_;
+        /// PageSize bytes of page data
+        const char* data_;
+      };
+
+      /// iterates over all pages which are not blank
+      struct const_iterator
+      {
+      public:
+        /// create iterator pointing to page _index of _image
+        const_iterator( const Image* _image, int _index );
+        /// return view of the current page
+        Page operator*() const;
+        /// advance to the next non blank page
+        const_iterator& operator++();
+        /// compare iterators
+        bool operator!=( const const_iterator& _other ) const;
+        /// return index of the current page
+        int index() const;
+
+      private:
+        /// iterated image
+        const Image* image_;
+        /// current page index
+        int index_;
+      };
+
+      /// create an empty image
+      Image();
+      /** @brief create an image and find its blank pages
+       * @param _start page aligned start address
+       * @param _data image data (size is a multiple of PageSize)
+       * @param _ranges address ranges filled by records (default: whole image)
+       */
+      Image( unsigned long _start, const QByteArray& _data, const QVector<Range>& _ranges = QVector<Range>() );
+      /// return start address
+      unsigned long start() const;
+      /// return address behind the last byte
+      unsigned long endAddress() const;
+      /// return image data
+      const QByteArray& data() const;
+      /// return size of the image in bytes
+      int size() const;
+      /// return true if the image has no data
+      bool isEmpty() const;
+      /// return number of pages
+      int pageCount() const;
+      /// return number of pages which are not blank
+      int relevantCount() const;
+      /// return true if the page with the given index contains only 0xff
+      bool isBlank( int _index ) const;
+      /// return view of the page with the given index
+      Page page( int _index ) const;
+      /// return true if the given address lies within the image
+      bool contains( unsigned long _address ) const;
+      /// return byte at the given address
+      char at( unsigned long _address ) const;
+      /// return iterator to the first non blank page
+      const_iterator begin() const;
+      /// return iterator behind the last page
+      const_iterator end() const;
+      /// return address ranges filled by records
+      const QVector<Range>& ranges() const;
+      /// return true if all given bytes are 0xff
+      static bool isBlank( const char* _data, int _size );
+      /** @brief merge images into one
+       * @param _images images to merge
+       * @param _offsets address offset to apply to each image
+       * @param _result receives the merged image
+       * @param _conflict receives the first address filled by more than one image
+       * @return false if images overlap
+       */
+      static bool merge( const QVector<Image>& _images, const QVector<long>& _offsets, Image& _result, unsigned long& _conflict );
+
+    private:
+      /// start address
+      unsigned long start_;
+      /// image data
+      QByteArray data_;
+      /// ranges filled by records
+      QVector<Range> ranges_;
+      /// blank page bitmap
+      QBitArray blank_;
+      /// number of non blank pages
+      int relevant_;
+    };
+  }
+}
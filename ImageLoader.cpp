@@ -0,0 +1,82 @@
+#include "ImageLoader.h"
+#include <QDebug>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    ImageLoader::ImageLoader( const QVector<MotFile*>& _files, const QVector<long>& _offsets, unsigned long _top ) :
+      files_(_files),
+      offsets_(_offsets),
+      top_(_top),
+      ok_(true),
+      outside_(false),
+      conflict_(0)
+    {
+      Q_ASSERT(_files.size() == _offsets.size());
+    }
+    const Image& ImageLoader::image() const
+    {
+      return image_;
+    }
+    bool ImageLoader::ok() const
+    {
+      return ok_;
+    }
+    bool ImageLoader::outside() const
+    {
+      return outside_;
+    }
+    unsigned long ImageLoader::conflict() const
+    {
+      return conflict_;
+    }
+    void ImageLoader::run()
+    {
+      qDebug() << "ImageLoader::run: loading image from" << files_.size() << "file(s)";
+      // read all images
+      QVector<Image> _images;
+      foreach( MotFile* _file, files_ )
+      {
+        QByteArray _data;
+        QVector<Image::Range> _ranges;
+        unsigned long _start = _file->readImage(_data, &_ranges);
+        _images.append(Image(_start, _data, _ranges));
+      }
+      // moved ranges must stay inside the device
+      qint64 _lowest = top_;
+      qint64 _highest = 0;
+      for( int i=0; i<_images.size(); ++i )
+        foreach( const Image::Range& _range, _images[i].ranges() )
+        {
+          const qint64 _first = (qint64)_range.address_ + offsets_[i];
+          const qint64 _last = _first + (qint64)_range.size_ - 1;
+          if( _first < 0 || _last > (qint64)top_ )
+          {
+            qDebug() << "ImageLoader::run: range at" << QString::number(_range.address_,16) << "moved outside of the device";
+            ok_ = false;
+            outside_ = true;
+            conflict_ = _range.address_;
+            return;
+          }
+          _lowest = qMin(_lowest, _first);
+          _highest = qMax(_highest, _last);
+        }
+      // the merged image is held in one byte array
+      if( _highest - _lowest >= 0x7fffff00 )
+      {
+        qDebug() << "ImageLoader::run: merged image too large";
+        ok_ = false;
+        outside_ = true;
+        conflict_ = _highest;
+        return;
+      }
+      // a single file needs no merge
+      if( 1 == _images.size() && 0 == offsets_.first() )
+        image_ = _images.first();
+      else
+        ok_ = Image::merge(_images, offsets_, image_, conflict_);
+      qDebug() << "ImageLoader::run: planned" << image_.relevantCount() << "page(s)";
+    }
+  }
+}
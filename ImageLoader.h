@@ -0,0 +1,50 @@
+#pragma once
+#include "MotFile.h"
+#include "Image.h"
+#include <QThread>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// loads an image from one or more MOT files in a worker thread
+    struct ImageLoader : QThread
+    {
+    public:
+      /** @brief create a loader
+       * @param _files opened MOT files to read the image from
+       * @param _offsets address offset to apply to each file
+       * @param _top last address of the device
+       */
+      ImageLoader( const QVector<MotFile*>& _files, const QVector<long>& _offsets, unsigned long _top );
+      /// return the loaded image
+      const Image& image() const;
+      /// return false if the files overlap or lie outside of the device
+      bool ok() const;
+      /// return true if a file has been moved outside of the device
+      bool outside() const;
+      /// return first address which is filled by more than one file (or original address of the range outside)
+      unsigned long conflict() const;
+
+    protected:
+      /// read and merge images and find their blank pages
+      void run();
+
+    private:
+      /// files to read
+      QVector<MotFile*> files_;
+      /// offsets of the files
+      QVector<long> offsets_;
+      /// last address of the device
+      unsigned long top_;
+      /// loaded image
+      Image image_;
+      /// false if the files overlap or lie outside
+      bool ok_;
+      /// true if a file lies outside of the device
+      bool outside_;
+      /// first overlapping address
+      unsigned long conflict_;
+    };
+  }
+}
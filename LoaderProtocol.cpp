@@ -0,0 +1,144 @@
+#include "LoaderProtocol.h"
+#include <QDebug>
+#include <cstring>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    LoaderProtocol::LoaderProtocol( Connection& _connection ) :
+      connection_(_connection),
+      outstanding_(0)
+    {
+    }
+    Connection::Status LoaderProtocol::start( const QByteArray& _program )
+    {
+      qDebug() << "LoaderProtocol::start: downloading loader";
+      Connection::Status _status = connection_.download(_program);
+      if( Connection::Ready != _status )
+        return _status;
+      // loader says hello when it runs
+      char _hello;
+      if( connection_.read(&_hello, 1, 2000) != 1 || ACK != _hello )
+      {
+        qDebug() << "LoaderProtocol::start: loader does not answer";
+        return Connection::Timeout;
+      }
+      outstanding_ = 0;
+      return Connection::Ready;
+    }
+    Connection::Status LoaderProtocol::setBaudRate( qint32 _baud )
+    {
+      if( !connection_.supportsBaudRate(_baud) )
+        return Connection::ParameterError;
+      const char _data[4] = { char(_baud >> 24), char(_baud >> 16), char(_baud >> 8), char(_baud) };
+      // acknowledged at the old baud rate
+      Connection::Status _status = flush();
+      if( Connection::Ready == _status )
+        _status = send(SetBaud, 0, _data, sizeof(_data));
+      if( Connection::Ready == _status )
+        _status = acknowledge();
+      if( Connection::Ready != _status )
+        return _status;
+      qDebug() << "LoaderProtocol::setBaudRate: switching to" << _baud;
+      return connection_.setBaudRate(_baud) ? Connection::Ready : Connection::ParameterError;
+    }
+    Connection::Status LoaderProtocol::write( unsigned long _address, const char* _data, int _size )
+    {
+      Q_ASSERT(_size > 0 && _size <= MaxBlock);
+      // keep at most Window frames in flight
+      if( outstanding_ >= Window )
+      {
+        Connection::Status _status = acknowledge();
+        if( Connection::Ready != _status )
+          return _status;
+      }
+      return send(Write, _address, _data, _size);
+    }
+    Connection::Status LoaderProtocol::flush()
+    {
+      while( outstanding_ > 0 )
+      {
+        Connection::Status _status = acknowledge();
+        if( Connection::Ready != _status )
+          return _status;
+      }
+      return Connection::Ready;
+    }
+    Connection::Status LoaderProtocol::read( unsigned long _address, char* _data, int _size )
+    {
+      Q_ASSERT(_size > 0 && _size <= MaxBlock);
+      const char _length[2] = { char(_size >> 8), char(_size) };
+      Connection::Status _status = flush();
+      if( Connection::Ready == _status )
+        _status = send(Read, _address, _length, sizeof(_length));
+      if( Connection::Ready == _status )
+        _status = acknowledge();
+      if( Connection::Ready != _status )
+        return _status;
+      // data followed by its CRC
+      unsigned char _crc[2];
+      if( connection_.read(_data, _size) != _size || connection_.read((char*)_crc, 2) != 2 )
+        return Connection::Timeout;
+      if( crc16(_data, _size) != ((_crc[0] << 8) | _crc[1]) )
+      {
+        qDebug() << "LoaderProtocol::read: CRC error at" << QString::number(_address,16);
+        return Connection::TransferFailed;
+      }
+      return Connection::Ready;
+    }
+    quint16 LoaderProtocol::crc16( const char* _data, int _size, quint16 _crc )
+    {
+      for( int i=0; i<_size; ++i )
+      {
+        _crc ^= (quint16)((unsigned char)_data[i]) << 8;
+        for( int _bit=0; _bit<8; ++_bit )
+          _crc = (_crc & 0x8000) ? (_crc << 1) ^ 0x1021 : (_crc << 1);
+      }
+      return _crc;
+    }
+    Connection::Status LoaderProtocol::send( Command _command, unsigned long _address, const char* _data, int _size )
+    {
+      // assemble frame in the frame buffer
+      char* _p = frame_;
+      *_p++ = SOH;
+      *_p++ = _command;
+      *_p++ = _address >> 24;
+      *_p++ = _address >> 16;
+      *_p++ = _address >> 8;
+      *_p++ = _address;
+      *_p++ = _size >> 8;
+      *_p++ = _size;
+      if( _size > 0 )
+        memcpy(_p, _data, _size);
+      _p += _size;
+      // CRC from command to data
+      quint16 _crc = crc16(frame_ + 1, _p - frame_ - 1);
+      *_p++ = _crc >> 8;
+      *_p++ = _crc;
+      // write frame
+      if( connection_.write(frame_, _p - frame_) != _p - frame_ )
+        return Connection::NotConnected;
+      ++outstanding_;
+      return Connection::Ready;
+    }
+    Connection::Status LoaderProtocol::acknowledge()
+    {
+      Q_ASSERT(outstanding_ > 0);
+      char _answer;
+      // the answer may wait for the whole window to be transferred and
+      // its block to be programmed (16 pages of about 20 ms each)
+      const int _timeout = 1000 + Window * (MaxBlock + 9) * 10 * 1000 / qMax(1, (int)connection_.baud());
+      if( connection_.read(&_answer, 1, _timeout) != 1 )
+        return Connection::Timeout;
+      --outstanding_;
+      if( ACK == _answer )
+        return Connection::Ready;
+      // read error code
+      char _code = 0;
+      connection_.read(&_code, 1);
+      qDebug() << "LoaderProtocol::acknowledge: frame rejected with code" << (int)_code;
+      return Connection::TransferFailed;
+    }
+  }
+}
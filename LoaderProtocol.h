@@ -0,0 +1,81 @@
+#pragma once
+#include "Connection.h"
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /** @brief host side of the streamed protocol of a RAM flash loader
+     *
+     * Erasing is left to the boot ROM. The loader program is downloaded
+     * into RAM through the boot ROM and answers with ACK once it runs.
+     * From then on every request is a frame
+     *
+     *   SOH, command, address (4 bytes), length (2 bytes), data, CRC-16
+     *
+     * with big endian numbers and a CRC-16/CCITT over command to data. The
+     * loader answers each frame with ACK, or NAK and an error code. Write
+     * frames carry up to MaxBlock bytes and up to Window of them may be
+     * unacknowledged, so transfer and flash programming overlap without
+     * any status polling. Read responses are ACK, data and CRC-16.
+     */
+    struct LoaderProtocol
+    {
+    public:
+      /// protocol constants
+      enum
+      {
+        /// start of frame
+        SOH = 0x01,
+        /// frame accepted
+        ACK = 0x06,
+        /// frame rejected
+        NAK = 0x15,
+        /// maximum data per frame
+        MaxBlock = 0x1000,
+        /// maximum number of unacknowledged write frames
+        Window = 2
+      };
+      /// loader commands
+      enum Command
+      {
+        /// switch baud rate (data: 4 bytes) after acknowledging
+        SetBaud = 'B',
+        /// program data at address
+        Write = 'W',
+        /// read length bytes from address
+        Read = 'R'
+      };
+
+      /** @brief create protocol on top of an unlocked boot ROM connection
+       * @param _connection connection to download the loader through
+       */
+      LoaderProtocol( Connection& _connection );
+      /// download the loader program and wait until it answers
+      Connection::Status start( const QByteArray& _program );
+      /// switch loader and port to the given baud rate
+      Connection::Status setBaudRate( qint32 _baud );
+      /// program data (up to MaxBlock bytes) without waiting for its acknowledge
+      Connection::Status write( unsigned long _address, const char* _data, int _size );
+      /// wait until all written frames have been acknowledged
+      Connection::Status flush();
+      /// read data (up to MaxBlock bytes)
+      Connection::Status read( unsigned long _address, char* _data, int _size );
+      /// return CRC-16/CCITT of the given bytes
+      static quint16 crc16( const char* _data, int _size, quint16 _crc = 0xffff );
+
+    private:
+      /// send a frame
+      Connection::Status send( Command _command, unsigned long _address, const char* _data, int _size );
+      /// wait for the answer to a frame
+      Connection::Status acknowledge();
+
+      /// connection to the microcontroller
+      Connection& connection_;
+      /// number of unacknowledged frames
+      int outstanding_;
+      /// frame buffer
+      char frame_[8 + MaxBlock + 2];
+    };
+  }
+}
@@ -1,12 +1,19 @@
 #include "MotFile.h"
 #include <QDebug>
+#include <cstring>
 
 namespace Fkgo
 {
   namespace Programmer
   {
     MotFile::MotFile( const QString& _fileName ) :
-      QFile(_fileName)
+      QFile(_fileName),
+      pageAddress_(0),
+      page_(0x100,0xff),
+      pageValid_(false),
+      nextAddress_(0),
+      carryAddress_(0),
+      outOfOrder_(false)
     {
     }
     SRecord MotFile::read()
@@ -18,7 +25,7 @@ namespace Fkgo
       // return it
       return _record;
     }
-    unsigned long MotFile::readImage( QByteArray& _image )
+    unsigned long MotFile::readImage( QByteArray& _image, QVector<Image::Range>* _ranges )
     {
       // skip non data records at beginning 
       SRecord _record = read();
@@ -47,7 +54,19 @@ namespace Fkgo
           // append 0xff if there is a gap between the records
           _image.append( QByteArray( _record.address() - _start - _image.size(), 0xff ) );
           // add record data
-          _image.append(_record.data());
+          QByteArray _data = _record.data();
+          _image.append(_data);
+          // remember filled range (join adjacent records)
+          if( _ranges )
+          {
+            if( !_ranges->isEmpty() && _ranges->last().address_ + _ranges->last().size_ == _record.address() )
+              _ranges->last().size_ += _data.size();
+            else
+            {
+              Image::Range _range = { _record.address(), (unsigned long)_data.size() };
+              _ranges->append(_range);
+            }
+          }
         }
         // read next record
         _record = read();
@@ -58,5 +77,65 @@ namespace Fkgo
       // return start address
       return _start;
     }
+    bool MotFile::readPage( unsigned long& _address, QByteArray& _page )
+    {
+      for(;;)
+      {
+        // fetch next data record if everything has been consumed
+        if( carry_.isEmpty() )
+        {
+          SRecord _record = read();
+          // end of input flushes the current page
+          if( _record.isEmpty() )
+          {
+            if( !pageValid_ )
+              return false;
+            _address = pageAddress_;
+            _page = page_;
+            pageValid_ = false;
+            nextAddress_ = pageAddress_ + 0x100;
+            return true;
+          }
+          if( !_record.isData() )
+            continue;
+          carryAddress_ = _record.address();
+          carry_ = _record.data();
+          // a record must not go back into a page which has been completed already
+          if( carryAddress_ < (pageValid_ ? pageAddress_ : nextAddress_) )
+          {
+            qDebug() << "MotFile::readPage: unexpected SRecord order";
+            outOfOrder_ = true;
+            return false;
+          }
+          continue;
+        }
+        // start a new page
+        if( !pageValid_ )
+        {
+          pageAddress_ = carryAddress_ - carryAddress_ % 0x100;
+          page_.fill(0xff);
+          pageValid_ = true;
+        }
+        // record starts beyond the current page: page is complete
+        if( carryAddress_ >= pageAddress_ + 0x100 )
+        {
+          _address = pageAddress_;
+          _page = page_;
+          pageValid_ = false;
+          nextAddress_ = pageAddress_ + 0x100;
+          return true;
+        }
+        // copy as much of the record into the page as fits
+        int _offset = carryAddress_ - pageAddress_;
+        int _length = qMin(carry_.size(), 0x100 - _offset);
+        memcpy(page_.data() + _offset, carry_.constData(), _length);
+        carry_.remove(0, _length);
+        carryAddress_ += _length;
+      }
+    }
+    bool MotFile::outOfOrder() const
+    {
+      return outOfOrder_;
+    }
   }
 }
@@ -1,4 +1,6 @@
+#pragma once
 #include "SRecord.h"
+#include "Image.h"
 #include <QFile>
 
 namespace Fkgo
@@ -10,10 +12,41 @@ namespace Fkgo
     {
       /// open MOT file
       MotFile( const QString& _fileName );
-      /// read an image out of the file
-      unsigned long readImage( QByteArray& _image );
+      /** @brief read an image out of the file
+       * @param _image receives the page aligned image data
+       * @param _ranges receives the address ranges filled by records (optional)
+       * @return start address of the image
+       */
+      unsigned long readImage( QByteArray& _image, QVector<Image::Range>* _ranges = 0 );
       /// read a single record from file
       SRecord read();
+      /** @brief read the next complete page while streaming records in address order
+       *
+       * A page is complete as soon as a record beyond its end arrives, so
+       * only one page is held in memory at any time.
+       * @param _address receives the page address
+       * @param _page receives 0x100 bytes of page data (0xff where no record wrote)
+       * @return false at the end of input or if the records are out of order
+       */
+      bool readPage( unsigned long& _address, QByteArray& _page );
+      /// return true if readPage() stopped because of records out of address order
+      bool outOfOrder() const;
+
+    private:
+      /// address of the page currently being filled
+      unsigned long pageAddress_;
+      /// page currently being filled
+      QByteArray page_;
+      /// true if page_ holds data
+      bool pageValid_;
+      /// end of the last completed page
+      unsigned long nextAddress_;
+      /// address of the first byte in carry_
+      unsigned long carryAddress_;
+      /// record data not yet copied into a page
+      QByteArray carry_;
+      /// true if records were found out of order while streaming
+      bool outOfOrder_;
     };
   }
 }
@@ -0,0 +1,52 @@
+#pragma once
+#include <QtGlobal>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// communication port backend used by a connection
+    struct Port
+    {
+    public:
+      /// close and destroy the port
+      virtual ~Port() {}
+      /// open the port with 9600/8N1
+      virtual bool open() = 0;
+      /// close the port
+      virtual void close() = 0;
+      /// return true if the port is open
+      virtual bool isOpen() const = 0;
+      /// change baud rate of the port
+      virtual bool setBaudRate( qint32 _baud ) = 0;
+      /// return currently used baud rate
+      virtual qint32 baudRate() const = 0;
+      /// return true if the port can run at the given baud rate
+      virtual bool supportsBaudRate( qint32 _baud ) const = 0;
+      /// write bytes to the port and return how many were written
+      virtual qint64 write( const char* _data, qint64 _size ) = 0;
+      /// write a header and a payload from separate buffers
+      virtual qint64 write( const char* _head, qint64 _headSize, const char* _body, qint64 _bodySize )
+      {
+        qint64 _written = write(_head, _headSize);
+        if( _written != _headSize )
+          return _written;
+        return _written + write(_body, _bodySize);
+      }
+      /// wait until written bytes have been passed to the device
+      virtual bool waitForBytesWritten( int _msecs ) = 0;
+      /// return number of bytes which can be read without waiting
+      virtual qint64 bytesAvailable() const = 0;
+      /// wait until new bytes are available for reading
+      virtual bool waitForReadyRead( int _msecs ) = 0;
+      /// read up to _max bytes without waiting
+      virtual qint64 read( char* _data, qint64 _max ) = 0;
+      /// discard any buffered input and output
+      virtual void clear() = 0;
+      /// set or clear the DTR modem line
+      virtual bool setDataTerminalReady( bool _set ) = 0;
+      /// set or clear the RTS modem line
+      virtual bool setRequestToSend( bool _set ) = 0;
+    };
+  }
+}
@@ -0,0 +1,123 @@
+#include "RecordingPort.h"
+#include <QDebug>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    RecordingPort::RecordingPort( Port* _port, const QString& _fileName ) :
+      port_(_port),
+      file_(_fileName)
+    {
+    }
+    RecordingPort::~RecordingPort()
+    {
+      close();
+      delete port_;
+    }
+    bool RecordingPort::open()
+    {
+      // create capture file
+      if( !file_.open(QIODevice::WriteOnly | QIODevice::Truncate) )
+      {
+        qDebug() << "RecordingPort::open: cannot create" << file_.fileName();
+        return false;
+      }
+      stream_.setDevice(&file_);
+      stream_.writeRawData("FRSC", 4);
+      stream_ << (quint8)Version;
+      timer_.start();
+      // open recorded port
+      return port_->open();
+    }
+    void RecordingPort::close()
+    {
+      port_->close();
+      if( file_.isOpen() )
+      {
+        stream_.setDevice(0);
+        file_.close();
+      }
+    }
+    bool RecordingPort::isOpen() const
+    {
+      return port_->isOpen();
+    }
+    bool RecordingPort::setBaudRate( qint32 _baud )
+    {
+      // big endian like the rest of the capture
+      const char _value[4] = { char(_baud >> 24), char(_baud >> 16), char(_baud >> 8), char(_baud) };
+      record(Baud, _value, sizeof(_value));
+      return port_->setBaudRate(_baud);
+    }
+    qint32 RecordingPort::baudRate() const
+    {
+      return port_->baudRate();
+    }
+    bool RecordingPort::supportsBaudRate( qint32 _baud ) const
+    {
+      return port_->supportsBaudRate(_baud);
+    }
+    qint64 RecordingPort::write( const char* _data, qint64 _size )
+    {
+      qint64 _written = port_->write(_data, _size);
+      if( _written > 0 )
+        record(Tx, _data, _written);
+      return _written;
+    }
+    qint64 RecordingPort::write( const char* _head, qint64 _headSize, const char* _body, qint64 _bodySize )
+    {
+      qint64 _written = port_->write(_head, _headSize, _body, _bodySize);
+      if( _written > 0 )
+        record(Tx, _head, qMin(_written, _headSize), _body, qMax<qint64>(0, _written - _headSize));
+      return _written;
+    }
+    bool RecordingPort::waitForBytesWritten( int _msecs )
+    {
+      return port_->waitForBytesWritten(_msecs);
+    }
+    qint64 RecordingPort::bytesAvailable() const
+    {
+      return port_->bytesAvailable();
+    }
+    bool RecordingPort::waitForReadyRead( int _msecs )
+    {
+      return port_->waitForReadyRead(_msecs);
+    }
+    qint64 RecordingPort::read( char* _data, qint64 _max )
+    {
+      qint64 _read = port_->read(_data, _max);
+      if( _read > 0 )
+        record(Rx, _data, _read);
+      return _read;
+    }
+    void RecordingPort::clear()
+    {
+      record(Clear, 0, 0);
+      port_->clear();
+    }
+    bool RecordingPort::setDataTerminalReady( bool _set )
+    {
+      const char _value[2] = { 'D', char(_set) };
+      record(Line, _value, sizeof(_value));
+      return port_->setDataTerminalReady(_set);
+    }
+    bool RecordingPort::setRequestToSend( bool _set )
+    {
+      const char _value[2] = { 'R', char(_set) };
+      record(Line, _value, sizeof(_value));
+      return port_->setRequestToSend(_set);
+    }
+    void RecordingPort::record( Event _event, const char* _data, qint64 _size, const char* _more, qint64 _moreSize )
+    {
+      if( !file_.isOpen() )
+        return;
+      // event header
+      stream_ << (quint8)_event << (quint64)timer_.nsecsElapsed() << (quint32)(_size + _moreSize);
+      // payload
+      stream_.writeRawData(_data, _size);
+      if( _moreSize > 0 )
+        stream_.writeRawData(_more, _moreSize);
+    }
+  }
+}
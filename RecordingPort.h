@@ -0,0 +1,75 @@
+#pragma once
+#include "Port.h"
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /** @brief port decorator which captures a serial session into a file
+     *
+     * The capture starts with the magic "FRSC" and a format version byte
+     * followed by one record per event: type (quint8), nanoseconds since
+     * open (quint64), payload length (quint32) and the payload.
+     */
+    struct RecordingPort : Port
+    {
+    public:
+      /// events of a capture
+      enum Event
+      {
+        /// bytes written to the microcontroller
+        Tx = 'T',
+        /// bytes received from the microcontroller
+        Rx = 'R',
+        /// baud rate change (payload: big endian quint32)
+        Baud = 'B',
+        /// buffers cleared
+        Clear = 'C',
+        /// modem line change (payload: 'D' or 'R' and 0 or 1)
+        Line = 'L'
+      };
+      /// capture format version
+      enum { Version = 1 };
+
+      /** @brief create a recording port
+       * @param _port port to record (will be owned)
+       * @param _fileName capture file to write
+       */
+      RecordingPort( Port* _port, const QString& _fileName );
+      /// destroy recorded port
+      ~RecordingPort();
+
+      bool open();
+      void close();
+      bool isOpen() const;
+      bool setBaudRate( qint32 _baud );
+      qint32 baudRate() const;
+      bool supportsBaudRate( qint32 _baud ) const;
+      qint64 write( const char* _data, qint64 _size );
+      qint64 write( const char* _head, qint64 _headSize, const char* _body, qint64 _bodySize );
+      bool waitForBytesWritten( int _msecs );
+      qint64 bytesAvailable() const;
+      bool waitForReadyRead( int _msecs );
+      qint64 read( char* _data, qint64 _max );
+      void clear();
+      bool setDataTerminalReady( bool _set );
+      bool setRequestToSend( bool _set );
+
+    private:
+      /// write an event record (payload may come in two parts)
+      void record( Event _event, const char* _data, qint64 _size, const char* _more = 0, qint64 _moreSize = 0 );
+
+      /// recorded port
+      Port* port_;
+      /// capture file
+      QFile file_;
+      /// stream into capture file
+      QDataStream stream_;
+      /// time since opening
+      QElapsedTimer timer_;
+    };
+  }
+}
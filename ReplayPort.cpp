@@ -0,0 +1,233 @@
+#include "ReplayPort.h"
+#include <QThread>
+#include <QDebug>
+#include <cstring>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    ReplayPort::ReplayPort( const QString& _fileName ) :
+      fileName_(_fileName),
+      next_(0),
+      offset_(0),
+      sync_(0),
+      baud_(9600),
+      open_(false),
+      mismatches_(0)
+    {
+    }
+    bool ReplayPort::open()
+    {
+      QFile _file(fileName_);
+      if( !_file.open(QIODevice::ReadOnly) )
+      {
+        qDebug() << "ReplayPort::open: cannot open" << fileName_;
+        return false;
+      }
+      QDataStream _stream(&_file);
+      // check file header
+      char _magic[4];
+      quint8 _version = 0;
+      if( _stream.readRawData(_magic, 4) != 4 || memcmp(_magic, "FRSC", 4) != 0 )
+      {
+        qDebug() << "ReplayPort::open: not a capture file" << fileName_;
+        return false;
+      }
+      _stream >> _version;
+      if( _version != RecordingPort::Version )
+      {
+        qDebug() << "ReplayPort::open: unsupported capture version" << _version;
+        return false;
+      }
+      // load all events
+      events_.clear();
+      while( !_stream.atEnd() )
+      {
+        quint8 _type;
+        quint32 _size;
+        Event _event;
+        _stream >> _type >> _event.time_ >> _size;
+        _event.type_ = (RecordingPort::Event)_type;
+        _event.data_.resize(_size);
+        if( _stream.readRawData(_event.data_.data(), _size) != (int)_size )
+        {
+          qDebug() << "ReplayPort::open: truncated capture" << fileName_;
+          break;
+        }
+        events_.append(_event);
+      }
+      qDebug() << "ReplayPort::open: loaded" << events_.size() << "event(s)";
+      next_ = 0;
+      offset_ = 0;
+      sync_ = 0;
+      baud_ = 9600;
+      open_ = true;
+      timer_.start();
+      return true;
+    }
+    void ReplayPort::close()
+    {
+      open_ = false;
+    }
+    bool ReplayPort::isOpen() const
+    {
+      return open_;
+    }
+    bool ReplayPort::setBaudRate( qint32 _baud )
+    {
+      baud_ = _baud;
+      // follow the recorded baud rate change if it is next
+      if( next_ < events_.size() && events_[next_].type_ == RecordingPort::Baud )
+      {
+        ++next_;
+        offset_ = 0;
+      }
+      return true;
+    }
+    qint32 ReplayPort::baudRate() const
+    {
+      return baud_;
+    }
+    bool ReplayPort::supportsBaudRate( qint32 ) const
+    {
+      // the capture tells which rates the device accepted
+      return true;
+    }
+    qint64 ReplayPort::write( const char* _data, qint64 _size )
+    {
+      qint64 _now = timer_.nsecsElapsed();
+      qint64 _pos = 0;
+      bool _differs = false;
+      while( _pos < _size )
+      {
+        skipTo(RecordingPort::Tx);
+        if( next_ >= events_.size() )
+        {
+          qDebug() << "ReplayPort::write: capture exhausted";
+          _differs = true;
+          break;
+        }
+        const Event& _event = events_[next_];
+        // responses are timed relative to the start of the transmission
+        if( 0 == offset_ )
+          sync_ = _now - _event.time_;
+        qint64 _count = qMin<qint64>(_size - _pos, _event.data_.size() - offset_);
+        if( memcmp(_data + _pos, _event.data_.constData() + offset_, _count) != 0 )
+        {
+          qDebug() << "ReplayPort::write: transmission differs from capture at event" << next_;
+          _differs = true;
+        }
+        _pos += _count;
+        offset_ += _count;
+        if( offset_ == _event.data_.size() )
+        {
+          ++next_;
+          offset_ = 0;
+        }
+      }
+      if( _differs )
+        ++mismatches_;
+      // a replayed port accepts everything
+      return _size;
+    }
+    bool ReplayPort::waitForBytesWritten( int )
+    {
+      return open_;
+    }
+    qint64 ReplayPort::bytesAvailable() const
+    {
+      return due(timer_.nsecsElapsed());
+    }
+    bool ReplayPort::waitForReadyRead( int _msecs )
+    {
+      qint64 _now = timer_.nsecsElapsed();
+      if( due(_now) > 0 )
+        return true;
+      // wait for the next response with its recorded delay
+      if( next_ < events_.size() && events_[next_].type_ == RecordingPort::Rx && 0 == offset_ )
+      {
+        qint64 _wait = (qint64)events_[next_].time_ + sync_ - _now;
+        if( _wait <= (qint64)_msecs * 1000000 )
+        {
+          QThread::usleep(_wait / 1000);
+          return true;
+        }
+      }
+      // nothing arrives in time
+      QThread::msleep(_msecs);
+      return false;
+    }
+    qint64 ReplayPort::read( char* _data, qint64 _max )
+    {
+      qint64 _now = timer_.nsecsElapsed();
+      qint64 _read = 0;
+      while( _read < _max && next_ < events_.size() && events_[next_].type_ == RecordingPort::Rx
+             && (qint64)events_[next_].time_ + sync_ <= _now )
+      {
+        const Event& _event = events_[next_];
+        qint64 _count = qMin<qint64>(_max - _read, _event.data_.size() - offset_);
+        memcpy(_data + _read, _event.data_.constData() + offset_, _count);
+        _read += _count;
+        offset_ += _count;
+        if( offset_ == _event.data_.size() )
+        {
+          ++next_;
+          offset_ = 0;
+        }
+      }
+      return _read;
+    }
+    void ReplayPort::clear()
+    {
+      skipTo(RecordingPort::Clear);
+      if( next_ < events_.size() )
+      {
+        ++next_;
+        offset_ = 0;
+      }
+    }
+    bool ReplayPort::setDataTerminalReady( bool )
+    {
+      // follow the recorded line change if it is next
+      if( next_ < events_.size() && events_[next_].type_ == RecordingPort::Line )
+      {
+        ++next_;
+        offset_ = 0;
+      }
+      return true;
+    }
+    bool ReplayPort::setRequestToSend( bool _set )
+    {
+      // both lines are recorded as the same event type
+      return setDataTerminalReady(_set);
+    }
+    int ReplayPort::mismatches() const
+    {
+      return mismatches_;
+    }
+    void ReplayPort::skipTo( RecordingPort::Event _type )
+    {
+      // a partially consumed event is continued
+      if( offset_ > 0 && next_ < events_.size() && events_[next_].type_ == _type )
+        return;
+      // drop everything that has not been consumed by the original session either
+      while( next_ < events_.size() && events_[next_].type_ != _type )
+      {
+        ++next_;
+        offset_ = 0;
+      }
+    }
+    qint64 ReplayPort::due( qint64 _now ) const
+    {
+      qint64 _count = 0;
+      for( int i=next_; i<events_.size() && events_[i].type_ == RecordingPort::Rx; ++i )
+      {
+        if( (qint64)events_[i].time_ + sync_ > _now )
+          break;
+        _count += events_[i].data_.size() - (i == next_ ? offset_ : 0);
+      }
+      return _count;
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "RecordingPort.h"
+#include <QVector>
+#include <QByteArray>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /** @brief port backend which replays a capture of a RecordingPort
+     *
+     * Bytes written are matched against the recorded transmissions. The
+     * recorded responses become readable with the same delay they had
+     * after the corresponding transmission in the original session.
+     */
+    struct ReplayPort : Port
+    {
+    public:
+      /** @brief create a replay port
+       * @param _fileName capture file to replay
+       */
+      ReplayPort( const QString& _fileName );
+
+      bool open();
+      void close();
+      bool isOpen() const;
+      bool setBaudRate( qint32 _baud );
+      qint32 baudRate() const;
+      bool supportsBaudRate( qint32 _baud ) const;
+      using Port::write;
+      qint64 write( const char* _data, qint64 _size );
+      bool waitForBytesWritten( int _msecs );
+      qint64 bytesAvailable() const;
+      bool waitForReadyRead( int _msecs );
+      qint64 read( char* _data, qint64 _max );
+      void clear();
+      bool setDataTerminalReady( bool _set );
+      bool setRequestToSend( bool _set );
+
+      /// return number of writes which differed from the capture or found it exhausted
+      int mismatches() const;
+
+    private:
+      /// a recorded event
+      struct Event
+      {
+        /// event type
+        RecordingPort::Event type_;
+        /// nanoseconds since recording started
+        quint64 time_;
+        /// payload
+        QByteArray data_;
+      };
+      /// skip undelivered responses up to the next event of the given type
+      void skipTo( RecordingPort::Event _type );
+      /// return number of received bytes due at the given time
+      qint64 due( qint64 _now ) const;
+
+      /// capture file name
+      QString fileName_;
+      /// recorded events
+      QVector<Event> events_;
+      /// index of the next event to replay
+      int next_;
+      /// bytes already consumed from the next event
+      int offset_;
+      /// wall clock minus recorded time of the last transmission
+      qint64 sync_;
+      /// current baud rate
+      qint32 baud_;
+      /// true if open
+      bool open_;
+      /// number of writes which differed from the capture
+      int mismatches_;
+      /// time since opening
+      QElapsedTimer timer_;
+    };
+  }
+}
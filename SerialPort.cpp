@@ -0,0 +1,75 @@
+#include "SerialPort.h"
+#include <QSerialPortInfo>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    SerialPort::SerialPort( const QString& _portName ) :
+      port_(_portName)
+    {
+    }
+    bool SerialPort::open()
+    {
+      // setup port
+      port_.setBaudRate(QSerialPort::Baud9600);
+      port_.setStopBits(QSerialPort::OneStop);
+      port_.setParity(QSerialPort::NoParity);
+      port_.setDataBits(QSerialPort::Data8);
+      // open port
+      return port_.open(QIODevice::ReadWrite);
+    }
+    void SerialPort::close()
+    {
+      port_.close();
+    }
+    bool SerialPort::isOpen() const
+    {
+      return port_.isOpen();
+    }
+    bool SerialPort::setBaudRate( qint32 _baud )
+    {
+      return port_.setBaudRate(_baud);
+    }
+    qint32 SerialPort::baudRate() const
+    {
+      return port_.baudRate();
+    }
+    bool SerialPort::supportsBaudRate( qint32 _baud ) const
+    {
+      return QSerialPortInfo::standardBaudRates().contains(_baud);
+    }
+    qint64 SerialPort::write( const char* _data, qint64 _size )
+    {
+      return port_.write(_data, _size);
+    }
+    bool SerialPort::waitForBytesWritten( int _msecs )
+    {
+      return port_.waitForBytesWritten(_msecs);
+    }
+    qint64 SerialPort::bytesAvailable() const
+    {
+      return port_.bytesAvailable();
+    }
+    bool SerialPort::waitForReadyRead( int _msecs )
+    {
+      return port_.waitForReadyRead(_msecs);
+    }
+    qint64 SerialPort::read( char* _data, qint64 _max )
+    {
+      return port_.read(_data, _max);
+    }
+    void SerialPort::clear()
+    {
+      port_.clear();
+    }
+    bool SerialPort::setDataTerminalReady( bool _set )
+    {
+      return port_.setDataTerminalReady(_set);
+    }
+    bool SerialPort::setRequestToSend( bool _set )
+    {
+      return port_.setRequestToSend(_set);
+    }
+  }
+}
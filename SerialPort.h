@@ -0,0 +1,39 @@
+#pragma once
+#include "Port.h"
+#include <QSerialPort>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /// port backend based on QSerialPort
+    struct SerialPort : Port
+    {
+    public:
+      /** @brief create a port
+       * @param _portName name/path of the communictaion port
+       */
+      SerialPort( const QString& _portName );
+
+      bool open();
+      void close();
+      bool isOpen() const;
+      bool setBaudRate( qint32 _baud );
+      qint32 baudRate() const;
+      bool supportsBaudRate( qint32 _baud ) const;
+      using Port::write;
+      qint64 write( const char* _data, qint64 _size );
+      bool waitForBytesWritten( int _msecs );
+      qint64 bytesAvailable() const;
+      bool waitForReadyRead( int _msecs );
+      qint64 read( char* _data, qint64 _max );
+      void clear();
+      bool setDataTerminalReady( bool _set );
+      bool setRequestToSend( bool _set );
+
+    private:
+      /// underlying serial port
+      QSerialPort port_;
+    };
+  }
+}
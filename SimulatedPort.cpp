@@ -0,0 +1,325 @@
+#include "SimulatedPort.h"
+#include "LoaderProtocol.h"
+#include "DeviceModel.h"
+#include "Command.h"
+#include "Image.h"
+#include <QThread>
+#include <QDebug>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    SimulatedPort::SimulatedPort( Connection::Device _device, const QByteArray& _id ) :
+      device_(_device),
+      id_(_id),
+      locked_(!_id.isEmpty()),
+      loader_(false),
+      open_(false),
+      baud_(9600),
+      srd1_(0x80),
+      msb_(0),
+      dtr_(false),
+      rts_(false)
+    {
+    }
+    bool SimulatedPort::open()
+    {
+      // a fresh session starts in the boot ROM
+      open_ = true;
+      loader_ = false;
+      locked_ = !id_.isEmpty();
+      baud_ = 9600;
+      in_.clear();
+      out_.clear();
+      lines_.clear();
+      timer_.start();
+      return true;
+    }
+    void SimulatedPort::close()
+    {
+      open_ = false;
+    }
+    bool SimulatedPort::isOpen() const
+    {
+      return open_;
+    }
+    bool SimulatedPort::setBaudRate( qint32 _baud )
+    {
+      baud_ = _baud;
+      return true;
+    }
+    qint32 SimulatedPort::baudRate() const
+    {
+      return baud_;
+    }
+    bool SimulatedPort::supportsBaudRate( qint32 ) const
+    {
+      return true;
+    }
+    qint64 SimulatedPort::write( const char* _data, qint64 _size )
+    {
+      in_.append(_data, _size);
+      // execute everything which is complete
+      while( !in_.isEmpty() && ( loader_ ? loaderFrame() : bootCommand() ) )
+        ;
+      return _size;
+    }
+    bool SimulatedPort::waitForBytesWritten( int )
+    {
+      return open_;
+    }
+    qint64 SimulatedPort::bytesAvailable() const
+    {
+      return out_.size();
+    }
+    bool SimulatedPort::waitForReadyRead( int _msecs )
+    {
+      if( !out_.isEmpty() )
+        return true;
+      // the device answers immediately or never
+      QThread::msleep(_msecs);
+      return false;
+    }
+    qint64 SimulatedPort::read( char* _data, qint64 _max )
+    {
+      qint64 _count = qMin<qint64>(_max, out_.size());
+      memcpy(_data, out_.constData(), _count);
+      out_.remove(0, _count);
+      return _count;
+    }
+    void SimulatedPort::clear()
+    {
+      in_.clear();
+      out_.clear();
+    }
+    bool SimulatedPort::setDataTerminalReady( bool _set )
+    {
+      changeLine('D', dtr_, _set);
+      return open_;
+    }
+    bool SimulatedPort::setRequestToSend( bool _set )
+    {
+      changeLine('R', rts_, _set);
+      return open_;
+    }
+    const QVector<SimulatedPort::LineChange>& SimulatedPort::lineChanges() const
+    {
+      return lines_;
+    }
+    void SimulatedPort::changeLine( char _line, bool& _level, bool _set )
+    {
+      LineChange _change = { _line, _set, timer_.elapsed() };
+      lines_.append(_change);
+      qDebug() << "SimulatedPort::changeLine:" << (_line == 'D' ? "DTR" : "RTS") << "=" << _set << "at" << _change.time_ << "ms";
+      // a falling edge resets the microcontroller into the boot ROM
+      if( _level && !_set )
+      {
+        loader_ = false;
+        locked_ = !id_.isEmpty();
+        srd1_ = 0x80;
+        msb_ = 0;
+        in_.clear();
+        out_.clear();
+      }
+      _level = _set;
+    }
+    bool SimulatedPort::bootCommand()
+    {
+      const unsigned char* _in = (const unsigned char*)in_.constData();
+      const int _size = in_.size();
+      // page address of a command header (24 bits plus prefix)
+      const unsigned long _page = (msb_ << 24) | (_size >= 3 ? ((unsigned long)_in[2] << 16) | ((unsigned long)_in[1] << 8) : 0);
+      int _used = 1;
+      switch( _in[0] )
+      {
+      case 0x00:
+        // auto baud
+        break;
+      case BAUD_9600:
+      case BAUD_19200:
+      case BAUD_38400:
+      case BAUD_57600:
+      case BAUD_115200:
+        out_.append(char(_in[0]));
+        break;
+      case GET_VERSION:
+        out_.append("VER.4.04");
+        break;
+      case GET_STATUS:
+        out_.append(char(srd1_));
+        out_.append(char(locked_ ? 0x00 : 0x0C));
+        break;
+      case CLEAR_STATUS:
+        srd1_ = 0x80;
+        break;
+      case MSB:
+        if( _size < 2 )
+          return false;
+        msb_ = _in[1];
+        in_.remove(0, 2);
+        // prefix applies to the next command only
+        return true;
+      case UNLOCK:
+        if( _size < 5 || _size < 5 + _in[4] )
+          return false;
+        _used = 5 + _in[4];
+        if( in_.mid(5, _in[4]) == id_ )
+          locked_ = false;
+        break;
+      case ERASE:
+        if( _size < 2 )
+          return false;
+        _used = 2;
+        if( !locked_ && ALL == _in[1] )
+          flash_.clear();
+        break;
+      case BLOCK_ERASE:
+        if( _size < 4 )
+          return false;
+        _used = 4;
+        if( !locked_ && ALL == _in[3] )
+          eraseBlock(_page);
+        break;
+      case PROGRAM_PAGE:
+        if( _size < 3 + Image::PageSize )
+          return false;
+        _used = 3 + Image::PageSize;
+        if( !locked_ )
+          program(_page, in_.constData() + 3, Image::PageSize);
+        break;
+      case READ_PAGE:
+        if( _size < 3 )
+          return false;
+        _used = 3;
+        if( !locked_ )
+          out_.append(fetch(_page, Image::PageSize));
+        break;
+      case DOWNLOAD:
+        {
+          if( _size < 4 )
+            return false;
+          const int _length = _in[1] | (_in[2] << 8);
+          if( _size < 4 + _length )
+            return false;
+          _used = 4 + _length;
+          unsigned char _checksum = 0;
+          for( int i=0; i<_length; ++i )
+            _checksum += _in[4+i];
+          if( !locked_ && _checksum == _in[3] )
+          {
+            // the loader says hello
+            qDebug() << "SimulatedPort::bootCommand: loader started";
+            loader_ = true;
+            out_.append(char(LoaderProtocol::ACK));
+          }
+        }
+        break;
+      default:
+        qDebug() << "SimulatedPort::bootCommand: unknown command" << QString::number(_in[0],16);
+        break;
+      }
+      msb_ = 0;
+      in_.remove(0, _used);
+      return true;
+    }
+    bool SimulatedPort::loaderFrame()
+    {
+      const unsigned char* _in = (const unsigned char*)in_.constData();
+      // resynchronize on the start of a frame
+      if( LoaderProtocol::SOH != _in[0] )
+      {
+        in_.remove(0, 1);
+        return true;
+      }
+      if( in_.size() < 8 )
+        return false;
+      const unsigned long _address = ((unsigned long)_in[2] << 24) | ((unsigned long)_in[3] << 16) | ((unsigned long)_in[4] << 8) | _in[5];
+      const int _length = (_in[6] << 8) | _in[7];
+      if( in_.size() < 8 + _length + 2 )
+        return false;
+      const char* _data = in_.constData() + 8;
+      const quint16 _crc = (_in[8+_length] << 8) | _in[9+_length];
+      if( LoaderProtocol::crc16(in_.constData() + 1, 7 + _length) != _crc )
+      {
+        // CRC error
+        out_.append(char(LoaderProtocol::NAK));
+        out_.append(char(1));
+      }
+      else
+      {
+        switch( _in[1] )
+        {
+        case LoaderProtocol::SetBaud:
+          // switched after the acknowledge has been sent
+          out_.append(char(LoaderProtocol::ACK));
+          break;
+        case LoaderProtocol::Write:
+          program(_address, _data, _length);
+          out_.append(char(LoaderProtocol::ACK));
+          break;
+        case LoaderProtocol::Read:
+          {
+            const int _count = ((unsigned char)_data[0] << 8) | (unsigned char)_data[1];
+            const QByteArray _bytes = fetch(_address, _count);
+            const quint16 _check = LoaderProtocol::crc16(_bytes.constData(), _bytes.size());
+            out_.append(char(LoaderProtocol::ACK));
+            out_.append(_bytes);
+            out_.append(char(_check >> 8));
+            out_.append(char(_check));
+          }
+          break;
+        default:
+          // unknown command
+          out_.append(char(LoaderProtocol::NAK));
+          out_.append(char(2));
+          break;
+        }
+      }
+      in_.remove(0, 8 + _length + 2);
+      return true;
+    }
+    void SimulatedPort::eraseBlock( unsigned long _address )
+    {
+      foreach( const DeviceModel::Block& _block, DeviceModel::blocks(device_, _address) )
+      {
+        if( _address < _block.address_ || _address - _block.address_ >= _block.size_ )
+          continue;
+        // drop all pages of the block
+        QHash<unsigned long,QByteArray>::iterator _it = flash_.begin();
+        while( _it != flash_.end() )
+        {
+          if( _it.key() >= _block.address_ && _it.key() - _block.address_ < _block.size_ )
+            _it = flash_.erase(_it);
+          else
+            ++_it;
+        }
+        return;
+      }
+    }
+    void SimulatedPort::program( unsigned long _address, const char* _data, int _size )
+    {
+      for( int i=0; i<_size; ++i )
+      {
+        const unsigned long _page = (_address + i) & ~(Image::PageSize-1);
+        QHash<unsigned long,QByteArray>::iterator _it = flash_.find(_page);
+        if( _it == flash_.end() )
+          _it = flash_.insert(_page, QByteArray(Image::PageSize, char(0xff)));
+        // flash can only clear bits
+        (*_it).data()[(_address + i) - _page] &= _data[i];
+      }
+    }
+    QByteArray SimulatedPort::fetch( unsigned long _address, int _size ) const
+    {
+      QByteArray _bytes(_size, char(0xff));
+      for( int i=0; i<_size; ++i )
+      {
+        const unsigned long _page = (_address + i) & ~(Image::PageSize-1);
+        QHash<unsigned long,QByteArray>::const_iterator _it = flash_.constFind(_page);
+        if( _it != flash_.constEnd() )
+          _bytes[i] = (*_it)[(int)((_address + i) - _page)];
+      }
+      return _bytes;
+    }
+  }
+}
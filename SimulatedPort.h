@@ -0,0 +1,106 @@
+#pragma once
+#include "Port.h"
+#include "Connection.h"
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /** @brief port backend which simulates a microcontroller in boot mode
+     *
+     * The boot ROM commands used by Connection are answered right away
+     * from a flash memory held in RAM. A program downloaded with the
+     * download command is taken for a loader which speaks the frame
+     * protocol of LoaderProtocol from then on. Changes of the modem lines
+     * are recorded and a falling edge of DTR or RTS restarts the boot ROM
+     * like a reset does.
+     */
+    struct SimulatedPort : Port
+    {
+    public:
+      /** @brief create a simulated device
+       * @param _device device type (selects the command encoding)
+       * @param _id ID code which locks the device (empty: unlocked)
+       */
+      SimulatedPort( Connection::Device _device = Connection::M16C, const QByteArray& _id = QByteArray() );
+
+      bool open();
+      void close();
+      bool isOpen() const;
+      bool setBaudRate( qint32 _baud );
+      qint32 baudRate() const;
+      bool supportsBaudRate( qint32 _baud ) const;
+      using Port::write;
+      qint64 write( const char* _data, qint64 _size );
+      bool waitForBytesWritten( int _msecs );
+      qint64 bytesAvailable() const;
+      bool waitForReadyRead( int _msecs );
+      qint64 read( char* _data, qint64 _max );
+      void clear();
+      bool setDataTerminalReady( bool _set );
+      bool setRequestToSend( bool _set );
+
+      /// a recorded modem line change
+      struct LineChange
+      {
+        /// 'D' for DTR or 'R' for RTS
+        char line_;
+        /// new level
+        bool set_;
+        /// milliseconds since opening
+        qint64 time_;
+      };
+      /// return recorded modem line changes
+      const QVector<LineChange>& lineChanges() const;
+
+    private:
+      /// execute a complete boot ROM command at the start of the input (false: need more bytes)
+      bool bootCommand();
+      /// execute a complete loader frame at the start of the input (false: need more bytes)
+      bool loaderFrame();
+      /// erase the block containing the given address
+      void eraseBlock( unsigned long _address );
+      /// program bytes into flash (bits can only be cleared)
+      void program( unsigned long _address, const char* _data, int _size );
+      /// read bytes from flash
+      QByteArray fetch( unsigned long _address, int _size ) const;
+      /// record a modem line change and restart the boot ROM on a falling edge
+      void changeLine( char _line, bool& _level, bool _set );
+
+      /// device type
+      Connection::Device device_;
+      /// ID code
+      QByteArray id_;
+      /// true while the ID has not been sent
+      bool locked_;
+      /// true after a loader has been downloaded
+      bool loader_;
+      /// true if open
+      bool open_;
+      /// current baud rate
+      qint32 baud_;
+      /// status register 1
+      quint8 srd1_;
+      /// most significant address byte of the next command (R32C)
+      unsigned long msb_;
+      /// received bytes not yet executed
+      QByteArray in_;
+      /// responses not yet read
+      QByteArray out_;
+      /// programmed pages (missing pages are blank)
+      QHash<unsigned long,QByteArray> flash_;
+      /// DTR level
+      bool dtr_;
+      /// RTS level
+      bool rts_;
+      /// recorded modem line changes
+      QVector<LineChange> lines_;
+      /// time since opening
+      QElapsedTimer timer_;
+    };
+  }
+}
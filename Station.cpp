@@ -0,0 +1,111 @@
+#include "Station.h"
+#include <QSerialPortInfo>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QDir>
+#include <QDebug>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    Station::Worker::Worker( const QString& _port, const Station& _station ) :
+      port_(_port),
+      station_(_station),
+      result_(Flasher::CannotConnect),
+      elapsed_(0),
+      reported_(false)
+    {
+    }
+    void Station::Worker::run()
+    {
+      QElapsedTimer _timer;
+      _timer.start();
+      // open port with the configured backend
+      Connection _c;
+      _c.open(port_, station_.options_.device_, station_.backend_);
+      // run all steps
+      result_ = Flasher(_c, station_.options_, port_ + ": ").run(station_.image_);
+      elapsed_ = _timer.elapsed();
+    }
+
+    Station::Station( const QString& _pattern, const Image& _image, const Flasher::Options& _options, Connection::Backend _backend ) :
+      pattern_(_pattern),
+      image_(_image),
+      options_(_options),
+      backend_(_backend)
+    {
+      // progress bars of several ports would mix up
+      options_.progress_ = false;
+    }
+    Station::~Station()
+    {
+      foreach( Worker* _worker, workers_ )
+      {
+        _worker->wait();
+        delete _worker;
+      }
+    }
+    void Station::run()
+    {
+      Flasher::print("station: watching " + pattern_);
+      for(;;)
+      {
+        const QStringList _present = scan();
+        // start flashing new ports right away
+        foreach( const QString& _port, _present )
+        {
+          if( workers_.contains(_port) )
+            continue;
+          Flasher::print("START " + _port);
+          Worker* _worker = new Worker(_port, *this);
+          workers_.insert(_port, _worker);
+          _worker->start();
+        }
+        // report finished ports and forget removed ones
+        QMap<QString,Worker*>::iterator _it = workers_.begin();
+        while( _it != workers_.end() )
+        {
+          Worker* _worker = _it.value();
+          if( _worker->isFinished() && !_worker->reported_ )
+          {
+            if( Flasher::Passed == _worker->result_ )
+              Flasher::print("PASS " + _worker->port_ + " (" + QString::number(_worker->elapsed_) + " ms)");
+            else
+              Flasher::print("FAIL " + _worker->port_ + ": " + Flasher::toString(_worker->result_));
+            _worker->reported_ = true;
+          }
+          if( _worker->reported_ && !_present.contains(_it.key()) )
+          {
+            delete _worker;
+            _it = workers_.erase(_it);
+          }
+          else
+            ++_it;
+        }
+        QThread::msleep(PollInterval);
+      }
+    }
+    QStringList Station::scan() const
+    {
+      QStringList _result;
+      QRegExp _wildcard(QFileInfo(pattern_).fileName(), Qt::CaseSensitive, QRegExp::Wildcard);
+      if( pattern_.contains('/') )
+      {
+        // look for device files and links in the directory
+        QDir _dir(QFileInfo(pattern_).path());
+        foreach( const QString& _name, _dir.entryList(QStringList(QFileInfo(pattern_).fileName()), QDir::Files | QDir::System) )
+          _result.append(_dir.filePath(_name));
+      }
+      else
+      {
+        // ask Qt for serial ports
+        foreach( const QSerialPortInfo& _info, QSerialPortInfo::availablePorts() )
+          if( _wildcard.exactMatch(_info.portName()) )
+            _result.append(_info.systemLocation());
+      }
+      return _result;
+    }
+  }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "Flasher.h"
+#include <QThread>
+#include <QMap>
+#include <QStringList>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /** @brief flashes boards automatically as their serial ports appear
+     *
+     * A pattern containing a path (e.g. /dev/ttyUSB*) is matched against
+     * the file system, which also finds pty links created by scripts.
+     * Otherwise it is matched against the names QSerialPortInfo reports.
+     * Each new port is flashed in its own thread. A port is flashed again
+     * after it has disappeared and reappeared.
+     */
+    struct Station
+    {
+    public:
+      /// interval of looking for new ports in milliseconds
+      enum { PollInterval = 200 };
+
+      /** @brief create a station
+       * @param _pattern wildcard pattern of the ports to watch
+       * @param _image image to flash
+       * @param _options flash options
+       * @param _backend port backend to use
+       */
+      Station( const QString& _pattern, const Image& _image, const Flasher::Options& _options, Connection::Backend _backend );
+      /// stop running flashers
+      ~Station();
+      /// watch for ports and flash each new one (never returns)
+      void run();
+
+    private:
+      /// flashes a single port
+      struct Worker : QThread
+      {
+      public:
+        /// create a worker for the given port
+        Worker( const QString& _port, const Station& _station );
+        /// port to flash
+        QString port_;
+        /// station which started the worker
+        const Station& station_;
+        /// result of the flash run
+        Flasher::Result result_;
+        /// duration of the flash run
+        qint64 elapsed_;
+        /// true if the result has been reported
+        bool reported_;
+
+      protected:
+        /// flash the port
+        void run();
+      };
+      /// return ports currently present
+      QStringList scan() const;
+
+      /// port pattern
+      QString pattern_;
+      /// image to flash
+      Image image_;
+      /// flash options
+      Flasher::Options options_;
+      /// port backend
+      Connection::Backend backend_;
+      /// workers by port name
+      QMap<QString,Worker*> workers_;
+    };
+  }
+}
@@ -0,0 +1,267 @@
+#include "TermiosPort.h"
+#include <QDebug>
+#include <QElapsedTimer>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+// termios2 for arbitrary bit rates (must not be mixed with <termios.h>)
+#include <asm/termbits.h>
+#include <linux/serial.h>
+#endif
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    TermiosPort::TermiosPort( const QString& _portName ) :
+      portName_(_portName),
+      fd_(-1),
+      baud_(9600)
+    {
+    }
+    TermiosPort::~TermiosPort()
+    {
+      close();
+    }
+#ifdef Q_OS_LINUX
+    bool TermiosPort::open()
+    {
+      Q_ASSERT(fd_ < 0);
+      // open tty without becoming its controlling process
+      fd_ = ::open(portName_.toLocal8Bit().constData(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+      if( fd_ < 0 )
+      {
+        qDebug() << "TermiosPort::open: cannot open" << portName_ << ":" << strerror(errno);
+        return false;
+      }
+      // switch to raw mode 8N1
+      struct termios2 _tio;
+      if( ioctl(fd_, TCGETS2, &_tio) < 0 )
+      {
+        qDebug() << "TermiosPort::open: not a tty" << portName_;
+        close();
+        return false;
+      }
+      _tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+      _tio.c_oflag &= ~OPOST;
+      _tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+      _tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS);
+      _tio.c_cflag |= CS8 | CREAD | CLOCAL;
+      // never block inside read()
+      _tio.c_cc[VMIN] = 0;
+      _tio.c_cc[VTIME] = 0;
+      if( ioctl(fd_, TCSETS2, &_tio) < 0 )
+      {
+        qDebug() << "TermiosPort::open: cannot configure" << portName_ << ":" << strerror(errno);
+        close();
+        return false;
+      }
+      // enable low latency mode where the driver supports it (not on ptys)
+      struct serial_struct _serial;
+      if( ioctl(fd_, TIOCGSERIAL, &_serial) == 0 )
+      {
+        _serial.flags |= ASYNC_LOW_LATENCY;
+        if( ioctl(fd_, TIOCSSERIAL, &_serial) < 0 )
+          qDebug() << "TermiosPort::open: cannot enable low latency mode";
+      }
+      // start with 9600 baud
+      if( !setBaudRate(9600) )
+      {
+        close();
+        return false;
+      }
+      clear();
+      return true;
+    }
+    void TermiosPort::close()
+    {
+      if( fd_ >= 0 )
+      {
+        ::close(fd_);
+        fd_ = -1;
+      }
+    }
+    bool TermiosPort::setBaudRate( qint32 _baud )
+    {
+      if( fd_ < 0 || !supportsBaudRate(_baud) )
+        return false;
+      struct termios2 _tio;
+      if( ioctl(fd_, TCGETS2, &_tio) < 0 )
+        return false;
+      // use the given rate as is instead of a Bxxx constant
+      _tio.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+      _tio.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+      _tio.c_ispeed = _baud;
+      _tio.c_ospeed = _baud;
+      if( ioctl(fd_, TCSETS2, &_tio) < 0 )
+      {
+        qDebug() << "TermiosPort::setBaudRate: cannot set" << _baud << "baud:" << strerror(errno);
+        return false;
+      }
+      baud_ = _baud;
+      return true;
+    }
+    qint64 TermiosPort::write( const char* _data, qint64 _size )
+    {
+      if( fd_ < 0 )
+        return -1;
+      qint64 _written = 0;
+      while( _written < _size )
+      {
+        ssize_t _n = ::write(fd_, _data+_written, _size-_written);
+        if( _n > 0 )
+          _written += _n;
+        else if( _n < 0 && errno == EAGAIN )
+        {
+          // wait for space in the output queue
+          struct pollfd _pfd = { fd_, POLLOUT, 0 };
+          if( poll(&_pfd, 1, 1000) <= 0 )
+            break;
+        }
+        else if( _n < 0 && errno != EINTR )
+          break;
+      }
+      return _written;
+    }
+    qint64 TermiosPort::write( const char* _head, qint64 _headSize, const char* _body, qint64 _bodySize )
+    {
+      if( fd_ < 0 )
+        return -1;
+      // send header and payload with a single system call
+      struct iovec _iov[2] = { { (void*)_head, (size_t)_headSize }, { (void*)_body, (size_t)_bodySize } };
+      ssize_t _n = ::writev(fd_, _iov, 2);
+      if( _n < 0 )
+        _n = 0;
+      // write what the driver did not take at once
+      if( _n < _headSize )
+      {
+        qint64 _written = _n + write(_head+_n, _headSize-_n);
+        if( _written != _headSize )
+          return _written;
+        return _written + write(_body, _bodySize);
+      }
+      return _n + write(_body+(_n-_headSize), _bodySize-(_n-_headSize));
+    }
+    bool TermiosPort::waitForBytesWritten( int )
+    {
+      // write() hands everything to the driver before returning
+      return fd_ >= 0;
+    }
+    qint64 TermiosPort::bytesAvailable() const
+    {
+      int _count = 0;
+      if( fd_ < 0 || ioctl(fd_, FIONREAD, &_count) < 0 )
+        return 0;
+      return _count;
+    }
+    bool TermiosPort::waitForReadyRead( int _msecs )
+    {
+      if( fd_ < 0 )
+        return false;
+      QElapsedTimer _timer;
+      _timer.start();
+      for(;;)
+      {
+        int _remaining = qMax<qint64>(0, _msecs - _timer.elapsed());
+        struct pollfd _pfd = { fd_, POLLIN, 0 };
+        int _result = poll(&_pfd, 1, _remaining);
+        if( _result > 0 )
+          return 0 != (_pfd.revents & POLLIN);
+        if( _result == 0 || errno != EINTR )
+          return false;
+      }
+    }
+    qint64 TermiosPort::read( char* _data, qint64 _max )
+    {
+      if( fd_ < 0 )
+        return -1;
+      ssize_t _n = ::read(fd_, _data, _max);
+      if( _n < 0 )
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+      return _n;
+    }
+    void TermiosPort::clear()
+    {
+      if( fd_ >= 0 )
+        ioctl(fd_, TCFLSH, TCIOFLUSH);
+    }
+    bool TermiosPort::setDataTerminalReady( bool _set )
+    {
+      const int _line = TIOCM_DTR;
+      return fd_ >= 0 && ioctl(fd_, _set ? TIOCMBIS : TIOCMBIC, &_line) == 0;
+    }
+    bool TermiosPort::setRequestToSend( bool _set )
+    {
+      const int _line = TIOCM_RTS;
+      return fd_ >= 0 && ioctl(fd_, _set ? TIOCMBIS : TIOCMBIC, &_line) == 0;
+    }
+#else
+    bool TermiosPort::open()
+    {
+      qDebug() << "TermiosPort::open: native backend is only available on Linux";
+      return false;
+    }
+    void TermiosPort::close()
+    {
+    }
+    bool TermiosPort::setBaudRate( qint32 )
+    {
+      return false;
+    }
+    qint64 TermiosPort::write( const char*, qint64 )
+    {
+      return -1;
+    }
+    qint64 TermiosPort::write( const char*, qint64, const char*, qint64 )
+    {
+      return -1;
+    }
+    bool TermiosPort::waitForBytesWritten( int )
+    {
+      return false;
+    }
+    qint64 TermiosPort::bytesAvailable() const
+    {
+      return 0;
+    }
+    bool TermiosPort::waitForReadyRead( int )
+    {
+      return false;
+    }
+    qint64 TermiosPort::read( char*, qint64 )
+    {
+      return -1;
+    }
+    void TermiosPort::clear()
+    {
+    }
+    bool TermiosPort::setDataTerminalReady( bool )
+    {
+      return false;
+    }
+    bool TermiosPort::setRequestToSend( bool )
+    {
+      return false;
+    }
+#endif
+    bool TermiosPort::isOpen() const
+    {
+      return fd_ >= 0;
+    }
+    qint32 TermiosPort::baudRate() const
+    {
+      return baud_;
+    }
+    bool TermiosPort::supportsBaudRate( qint32 _baud ) const
+    {
+      // termios2 accepts any positive bit rate
+      return _baud > 0;
+    }
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "Port.h"
+#include <QString>
+
+namespace Fkgo
+{
+  namespace Programmer
+  {
+    /** @brief native Linux port backend
+     *
+     * Opens the tty directly, configures it through termios2 which allows
+     * arbitrary bit rates, enables the driver's low latency mode where
+     * available and waits with poll() for precise timeouts.
+     */
+    struct TermiosPort : Port
+    {
+    public:
+      /** @brief create a port
+       * @param _portName path of the tty device
+       */
+      TermiosPort( const QString& _portName );
+      /// close port on destruction
+      ~TermiosPort();
+
+      bool open();
+      void close();
+      bool isOpen() const;
+      bool setBaudRate( qint32 _baud );
+      qint32 baudRate() const;
+      bool supportsBaudRate( qint32 _baud ) const;
+      qint64 write( const char* _data, qint64 _size );
+      qint64 write( const char* _head, qint64 _headSize, const char* _body, qint64 _bodySize );
+      bool waitForBytesWritten( int _msecs );
+      qint64 bytesAvailable() const;
+      bool waitForReadyRead( int _msecs );
+      qint64 read( char* _data, qint64 _max );
+      void clear();
+      bool setDataTerminalReady( bool _set );
+      bool setRequestToSend( bool _set );
+
+    private:
+      /// path of the tty device
+      QString portName_;
+      /// file descriptor of the open tty or -1
+      int fd_;
+      /// current baud rate
+      qint32 baud_;
+    };
+  }
+}
@@ -9,7 +9,7 @@ QT       += core serialport
 include( common.pri )
 
 TARGET = flash-renesas
-CONFIG   += console
+CONFIG   += console c++11
 CONFIG   -= app_bundle
 
 TEMPLATE = app
@@ -1,18 +1,57 @@
 #include "Connection.h"
 #include "MotFile.h"
+#include "ImageLoader.h"
+#include "IdCode.h"
+#include "SerialPort.h"
+#include "TermiosPort.h"
+#include "RecordingPort.h"
+#include "ReplayPort.h"
+#include "SimulatedPort.h"
+#include "Flasher.h"
+#include "Station.h"
+#include "Analysis.h"
+#include "DeltaPlan.h"
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QDebug>
 #include <QString>
 #include <QFileInfo>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <cstring>
 
 #define HEX(x) QString::number(x,16)
 
-QString progress( int _cur, int _max, int _len )
+/** @brief open a MOT file and check its header (exits on failure)
+ * @param _name file name or - for stdin
+ * @param _out output stream
+ * @param _err error stream
+ * @return opened MOT file
+ */
+Fkgo::Programmer::MotFile* openMot( const QString& _name, QTextStream& _out, QTextStream& _err )
 {
-  int _step = _max/_len;
-  return QString() + "[" + QString(_cur/_step+1,'#') + QString(_max/_step-_cur/_step-1,'.') + "] " + QString::number(100*_cur/_max+1) + "%";
+  using namespace Fkgo::Programmer;
+  // read from stdin?
+  const bool _stdin = "-" == _name;
+  if( _stdin )
+    _out << "Opening MOT file from stdin" << endl;
+  else
+  {
+    QFileInfo info(_name);
+    _out << "Opening MOT file: '" << info.fileName() << "'  " << info.lastModified().toString() << endl;
+  }
+  MotFile* _file = new MotFile(_stdin ? QString() : _name);
+  if( _stdin ? !_file->open(stdin, QIODevice::ReadOnly | QIODevice::Text) : !_file->open(QIODevice::ReadOnly | QIODevice::Text) )
+  {
+    _err << "ERROR: MOT file not found" << endl;
+    exit(-1);
+  }
+  if( _file->read().type() != SRecord::Header )
+  {
+    _err << "ERROR: unexpected file format" << endl;
+    exit(-1);
+  }
+  return _file;
 }
 
 /** @brief main routine
@@ -30,16 +69,53 @@ int main(int _argc, char *_argv[])
   }
   // initialize argument parser
   QCommandLineParser _parser;
+  QCommandLineOption _native("native", QCoreApplication::translate("main", "Use the native termios serial backend (Linux only)."));
+  QCommandLineOption _record("record", QCoreApplication::translate("main", "Record the serial session into a capture file."), "file");
+  QCommandLineOption _replay("replay", QCoreApplication::translate("main", "Replay a captured serial session instead of using a port."), "file");
+  QCommandLineOption _blankCheck("blank-check", QCoreApplication::translate("main", "Read back every n-th programmed page and all pages the image leaves blank, and erase only blocks which are not blank."), "n");
+  QCommandLineOption _add("add", QCoreApplication::translate("main", "Merge another MOT file into the image, optionally moved by an address offset."), "file[@offset]");
+  QCommandLineOption _verify("verify", QCoreApplication::translate("main", "Read back and compare all programmed pages."));
+  QCommandLineOption _station("station", QCoreApplication::translate("main", "Flash every board whose serial port appears (e.g. /dev/ttyUSB* or ttyUSB*) until interrupted."), "pattern");
+  QCommandLineOption _analyze("analyze", QCoreApplication::translate("main", "Analyze the image and estimate the flash time at each baud rate."));
+  QCommandLineOption _latency("latency", QCoreApplication::translate("main", "Turnaround time of the serial adapter in ms for estimates (default: 2)."), "ms");
+  QCommandLineOption _loaderOption("loader", QCoreApplication::translate("main", "Download a flash loader program into RAM and program and verify through it."), "mot");
+  QCommandLineOption _loaderBaud("loader-baud", QCoreApplication::translate("main", "Baud rate to switch the flash loader to."), "baud");
+  QCommandLineOption _simulate("simulate", QCoreApplication::translate("main", "Flash a simulated microcontroller instead of using a port."));
+  QCommandLineOption _diff("diff", QCoreApplication::translate("main", "Compare the image with a base MOT file and write a delta plan (see --plan)."), "base");
+  QCommandLineOption _plan("plan", QCoreApplication::translate("main", "Delta plan file to write with --diff, or to apply: erase and program only the changed blocks."), "file");
+  QCommandLineOption _resetSequence("reset-sequence", QCoreApplication::translate("main", "Modem line steps which reset the controller into boot mode before connecting (e.g. dtr=1,rts=1,wait=50,dtr=0,wait=100)."), "steps");
+  QCommandLineOption _retries("retries", QCoreApplication::translate("main", "Repeat failed steps from connecting on up to n times."), "n");
+  QCommandLineOption _streamOption("stream", QCoreApplication::translate("main", "Program pages while the MOT file is still being read (records must be in address order)."));
   {
     _parser.setApplicationDescription("M16C flash utility");
     _parser.addHelpOption();
     _parser.addVersionOption();
-    _parser.addPositionalArgument("mot", QCoreApplication::translate("main", "MOT file to flash."));
+    _parser.addOption(_native);
+    _parser.addOption(_streamOption);
+    _parser.addOption(_add);
+    _parser.addOption(_verify);
+    _parser.addOption(_station);
+    _parser.addOption(_analyze);
+    _parser.addOption(_latency);
+    _parser.addOption(_blankCheck);
+    _parser.addOption(_record);
+    _parser.addOption(_replay);
+    _parser.addOption(_loaderOption);
+    _parser.addOption(_loaderBaud);
+    _parser.addOption(_simulate);
+    _parser.addOption(_diff);
+    _parser.addOption(_plan);
+    _parser.addOption(_resetSequence);
+    _parser.addOption(_retries);
+    _parser.addPositionalArgument("mot", QCoreApplication::translate("main", "MOT file to flash (- for stdin)."));
     _parser.addPositionalArgument("port", QCoreApplication::translate("main", "Serial port to connect."));
-    _parser.addPositionalArgument("id", QCoreApplication::translate("main", "Flash ID (default: 00:00:00:00:00:00:00 or ff:ff:ff:ff:ff:ff:ff)"),"[id]");
+    _parser.addPositionalArgument("id", QCoreApplication::translate("main", "Flash ID (default: ID from image, last working ID, 00:00:00:00:00:00:00 or ff:ff:ff:ff:ff:ff:ff)"),"[id]");
   }
   // Process the actual command line arguments given by the user
   _parser.process(_a);
+  // measure the whole run
+  QElapsedTimer _run;
+  _run.start();
   QTextStream _out(stdout);
   QTextStream _err(stderr);
   // get positional arguments
@@ -65,6 +141,12 @@ int main(int _argc, char *_argv[])
     }
     if( _args.size() >= 2 )
       _port = _args[1];
+    // a replayed session needs no port
+    if( _port.isEmpty() && _parser.isSet(_replay) )
+      _port = _parser.value(_replay);
+    // neither does a simulated one
+    if( _port.isEmpty() && _parser.isSet(_simulate) )
+      _port = "simulator";
   }
   QByteArray _id;
   if( _args.size() > 2 )
@@ -76,7 +158,7 @@ int main(int _argc, char *_argv[])
     for( int i=0; i<_ids.size() && ok; ++i )
       _id += _ids[i].toInt(&ok,16);
     // check if there wern't seven bytes
-    if( !ok || _id.size() != 7 )
+    if( !ok || _id.size() != Fkgo::Programmer::IdCode::Size )
     {
       // invalid ID
       _err << "ERROR: invalid ID" << endl;
@@ -84,104 +166,376 @@ int main(int _argc, char *_argv[])
       exit(-1);
     }
   }
+  // program while reading?
+  const bool _stream = _parser.isSet(_streamOption);
   using namespace Fkgo::Programmer;
+  // MOT files and their address offsets
+  QVector<MotFile*> _files;
+  QVector<long> _offsets;
+  _files.append(openMot(_mot, _out, _err));
+  _offsets.append(0);
+  foreach( const QString& _value, _parser.values(_add) )
   {
-    QFileInfo info(_mot);
-    _out << "Opening MOT file: '" << info.fileName() << "'  " << info.lastModified().toString() << endl;
+    // split off optional address offset
+    QString _name = _value;
+    long _offset = 0;
+    int _at = _value.lastIndexOf('@');
+    if( _at > 0 )
+    {
+      bool ok;
+      _offset = _value.mid(_at+1).toLong(&ok,0);
+      if( !ok )
+      {
+        _err << "ERROR: invalid address offset in " << _value << endl;
+        exit(-1);
+      }
+      _name = _value.left(_at);
+    }
+    _files.append(openMot(_name, _out, _err));
+    _offsets.append(_offset);
   }
-  MotFile file(_mot);
-  if( !file.open(QIODevice::ReadOnly | QIODevice::Text) )
+  if( _stream && _files.size() > 1 )
   {
-    _err << "ERROR: MOT file not found" << endl;
+    _err << "ERROR: cannot stream more than one MOT file" << endl;
     exit(-1);
   }
-  if( file.read().type() != SRecord::Header )
+  MotFile& file = *_files.first();
+  // load image while connecting to the microcontroller
+  // device type
+  const Connection::Device _device = Connection::M16C;
+  ImageLoader _loader(_files, _offsets, DeviceModel::top(_device));
+  if( !_stream )
+    _loader.start();
+  // wait for the image and stop on overlapping files
+  auto _waitForImage = [&]()
   {
-    _err << "ERROR: unexpected file format" << endl;
-    exit(-1);
+    _loader.wait();
+    if( _loader.outside() )
+    {
+      _err << "ERROR: MOT data at " << HEX(_loader.conflict()) << " is moved outside of the device" << endl;
+      exit(-1);
+    }
+    if( !_loader.ok() )
+    {
+      _err << "ERROR: MOT files overlap at " << HEX(_loader.conflict()) << endl;
+      exit(-1);
+    }
+  };
+  // flash options
+  Flasher::Options _options;
+  {
+    _options.device_ = _device;
+    _options.id_ = _id;
+    _options.blankCheck_ = _parser.isSet(_blankCheck) ? qMax(1,_parser.value(_blankCheck).toInt()) : 0;
+    _options.verify_ = _parser.isSet(_verify);
+    // sampling may miss dirty pages, so check what has been programmed
+    if( _options.blankCheck_ > 1 && !_options.verify_ )
+    {
+      _out << "blank check reads only every " << _options.blankCheck_ << ". page, enabling --verify" << endl;
+      _options.verify_ = true;
+    }
+    _options.progress_ = true;
+    _options.retries_ = _parser.isSet(_retries) ? qMax(0,_parser.value(_retries).toInt()) : 0;
+    // simulated and replayed timings say nothing about real devices
+    _options.measure_ = !_parser.isSet(_simulate) && !_parser.isSet(_replay);
+    if( _parser.isSet(_resetSequence) && !Connection::parseLineSequence(_parser.value(_resetSequence), _options.resetSequence_) )
+    {
+      _err << "ERROR: invalid reset sequence" << endl;
+      exit(-1);
+    }
   }
-  // create connection to the port given by parameter
-  Connection _c;
-  if( !_port.isEmpty() )
+  // flash loader program
+  if( _parser.isSet(_loaderOption) )
   {
-    _out << "opening connection to port " << _port << endl;
-    // create connection to the port given by parameter
-    _c.open(_port,Connection::M16C);
-    // connect to the microcontroller
-    if( Connection::Ready != _c.autoBaud() )
+    if( _stream )
     {
-      _err << "ERROR: cannot connect" << endl;
+      _err << "ERROR: cannot stream through a flash loader" << endl;
       exit(-1);
     }
-    if( Connection::Ready != _c.baudRate() )
+    // program bytes reach from the first to the last filled address
+    MotFile* _loaderFile = openMot(_parser.value(_loaderOption), _out, _err);
+    QVector<Image::Range> _ranges;
+    const unsigned long _start = _loaderFile->readImage(_options.loader_, &_ranges);
+    delete _loaderFile;
+    if( !_ranges.isEmpty() )
     {
-      _err << "ERROR: cannot negotiate baud rate" << endl;
-      _out << "No response at 9600 baud. You may reset the controller and try again." << endl;
+      _options.loader_.truncate(_ranges.last().address_ + _ranges.last().size_ - _start);
+      _options.loader_.remove(0, _ranges.first().address_ - _start);
+    }
+    if( _options.loader_.isEmpty() || _options.loader_.size() > 0xffff )
+    {
+      _err << "ERROR: invalid flash loader" << endl;
       exit(-1);
     }
-    _out << "negotiated baud rate: " << _c.baud() << endl;
-    // get version
-    QString _version;
-    if( Connection::Ready != _c.version(_version) )
+    _options.loaderBaud_ = _parser.isSet(_loaderBaud) ? _parser.value(_loaderBaud).toInt() : 0;
+  }
+  // analyze the image only
+  if( _parser.isSet(_analyze) )
+  {
+    if( _stream )
     {
-      _err << "ERROR: cannot get version" << endl;
+      _err << "ERROR: analysis needs the whole image" << endl;
       exit(-1);
     }
-    _out << "remote version: " << _version << endl;
-    // unlock the microcontroller with the ID given by argument
-    if( _id.isEmpty() )
+    _waitForImage();
+    Analysis(_loader.image(), _options.device_).report(_out, _parser.isSet(_latency) ? _parser.value(_latency).toDouble() : (double)Analysis::DefaultLatency);
+    qDeleteAll(_files);
+    return 0;
+  }
+  // make a delta plan from the base image to the new one
+  if( _parser.isSet(_diff) )
+  {
+    if( _stream || !_parser.isSet(_plan) )
     {
-      _id = QByteArray(7,0);
-      if( Connection::Locked == _c.unlock(_id) )
-      {
-        _id = QByteArray(7,0xff);
-        if( Connection::Ready != _c.unlock(_id) )
-        {
-          _err << "ERROR: unlocking failed" << endl;
-          exit(-1);
-        }
-      }
+      _err << "ERROR: diff needs the whole image and a plan file" << endl;
+      exit(-1);
     }
-    else if( Connection::Ready != _c.unlock(_id) )
+    // load base image in parallel to the new one
+    QVector<MotFile*> _baseFiles;
+    _baseFiles.append(openMot(_parser.value(_diff), _out, _err));
+    ImageLoader _baseLoader(_baseFiles, QVector<long>(1, 0), DeviceModel::top(_device));
+    _baseLoader.start();
+    _baseLoader.wait();
+    if( !_baseLoader.ok() )
     {
-      _err << "ERROR: unlocking failed" << endl;
+      _err << "ERROR: base image lies outside of the device" << endl;
       exit(-1);
     }
-    _out << "unlocked with: " << _id.toHex() << endl;
-    // eraseAll
-    _out << "erasing flash memory..." << endl;
-    if( Connection::Ready != _c.eraseAll() )
+    _waitForImage();
+    QElapsedTimer _timer;
+    _timer.start();
+    DeltaPlan _delta = DeltaPlan::diff(_options.device_, _baseLoader.image(), _loader.image());
+    const qint64 _elapsed = _timer.elapsed();
+    if( !_delta.save(_parser.value(_plan)) )
     {
-      _err << "ERROR: erasing flash memory failed" << endl;
+      _err << "ERROR: cannot write plan " << _parser.value(_plan) << endl;
       exit(-1);
     }
+    _delta.report(_out);
+    _out << "diff in " << _elapsed << " ms" << endl;
+    qDeleteAll(_baseFiles);
+    qDeleteAll(_files);
+    return 0;
   }
-  QByteArray _image;
-  // blank page
-  const QByteArray _blank(0x100,0xff);
-  unsigned long _start = file.readImage(_image);
-  _out << "Writing image from " << HEX(_start) << " to " << HEX(_start+_image.size()-1) << " = " << _image.size()/1024 << "KB" << endl;
-  unsigned long _count=0;
-  for( int _cur = 0; _cur < _image.size(); _cur += 0x100 )
+  // apply a delta plan made for this image
+  DeltaPlan _delta;
+  const bool _applyPlan = _parser.isSet(_plan);
+  if( _applyPlan )
   {
-    QByteArray _page = _image.mid(_cur, 0x100);
-    if( _page != _blank )
+    if( _stream || _parser.isSet(_station) )
     {
+      _err << "ERROR: a delta plan needs the whole image and a single port" << endl;
+      exit(-1);
+    }
+    if( !_delta.load(_parser.value(_plan)) )
+    {
+      _err << "ERROR: cannot read plan " << _parser.value(_plan) << endl;
+      exit(-1);
+    }
+    _waitForImage();
+    if( _delta.device() != _options.device_ || DeltaPlan::hash(_loader.image()) != _delta.targetHash() )
+    {
+      _err << "ERROR: image does not match the plan" << endl;
+      exit(-1);
+    }
+    _out << "plan: " << _delta.pages().size() << " changed page(s) in " << _delta.blocks().size() << " block(s)" << endl;
+    // the boards already carry the new image
+    if( _delta.pages().isEmpty() )
+    {
+      _out << "nothing to do" << endl;
+      qDeleteAll(_files);
+      return 0;
+    }
+  }
+  // flash every board appearing at the station
+  if( _parser.isSet(_station) )
+  {
+    if( _stream )
+    {
+      _err << "ERROR: station mode needs the whole image" << endl;
+      exit(-1);
+    }
+    _waitForImage();
+    Station(_parser.value(_station), _loader.image(), _options, _parser.isSet(_native) ? Connection::Native : Connection::QtSerial).run();
+  }
+  // simulated microcontroller and replayed capture (owned by the connection)
+  SimulatedPort* _simulator = 0;
+  ReplayPort* _replayPort = 0;
+  // report what the simulation or replay observed (returns false if the replay diverged)
+  auto _backend = [&]()
+  {
+    // show what reset sequences did to the simulated modem lines
+    if( 0 != _simulator )
+      foreach( const SimulatedPort::LineChange& _change, _simulator->lineChanges() )
+        _out << "line: " << (_change.line_ == 'D' ? "DTR" : "RTS") << "=" << (int)_change.set_ << " at " << _change.time_ << " ms" << endl;
+    // recorded responses to different commands are meaningless
+    if( 0 != _replayPort && _replayPort->mismatches() > 0 )
+    {
+      _err << "ERROR: " << _replayPort->mismatches() << " transmission(s) differ from the capture" << endl;
+      return false;
+    }
+    return true;
+  };
+  // stop on a failed step
+  auto _check = [&]( Flasher::Result _result )
+  {
+    if( Flasher::Passed == _result )
+      return;
+    _backend();
+    _err << "ERROR: " << Flasher::toString(_result) << endl;
+    if( Flasher::BaudRateFailed == _result && _options.resetSequence_.isEmpty() )
+      _out << "No response at 9600 baud. You may reset the controller and try again (or let --reset-sequence do it)." << endl;
+    exit(-1);
+  };
+  // create connection to the port given by parameter
+  Connection _c;
+  Flasher _flasher(_c, _options);
+  // run report
+  auto _report = [&]()
+  {
+    const bool _ok = _backend();
+    _out << "erase: " << _flasher.eraseReport() << endl;
+    _out << "finished in " << _run.elapsed() << " ms" << endl;
+    if( !_ok )
+      exit(-1);
+  };
+  // the base of a plan is checked once, a retry finds it partly rewritten
+  bool _baseChecked = false;
+  // steps up to erasing (the image is waited for only when needed)
+  // placeholder while the image is not needed or not available
+  static const Image _noImage;
+  auto _prepare = [&]() -> Flasher::Result
+  {
+    // connect to the microcontroller
+    Flasher::Result _result = _flasher.connect();
+    if( Flasher::Passed != _result )
+      return _result;
+    // the image is needed to find out the ID (not available while streaming),
+    // the loader's image must not be touched before it has finished
+    if( _id.isEmpty() && !_stream )
+    {
+      _waitForImage();
+      _result = _flasher.unlock(_loader.image());
+    }
+    else
+      _result = _flasher.unlock(_noImage);
+    if( Flasher::Passed != _result )
+      return _result;
+    if( _applyPlan )
+    {
+      // make sure the device holds the base image before changing it
+      if( !_baseChecked )
+      {
+        _result = _flasher.checkBase(_delta);
+        _baseChecked = Flasher::Passed == _result;
+      }
+      if( Flasher::Passed == _result )
+        _result = _flasher.erase(_delta);
+      return _result;
+    }
+    // the blank check needs the whole image
+    if( _options.blankCheck_ && !_stream )
+    {
+      _waitForImage();
+      return _flasher.erase(_loader.image());
+    }
+    return _flasher.erase(_noImage);
+  };
+  if( !_port.isEmpty() )
+  {
+    _out << "opening connection to port " << _port << endl;
+    // create port backend
+    Port* _p;
+    if( _parser.isSet(_replay) )
+      _p = _replayPort = new ReplayPort(_parser.value(_replay));
+    else if( _parser.isSet(_simulate) )
+      _p = _simulator = new SimulatedPort(_options.device_);
+    else if( _parser.isSet(_native) )
+      _p = new TermiosPort(_port);
+    else
+      _p = new SerialPort(_port);
+    // capture session if wanted
+    if( _parser.isSet(_record) )
+      _p = new RecordingPort(_p, _parser.value(_record));
+    // create connection to the port given by parameter
+    _c.open(_p,_options.device_,_port);
+    // a streamed image cannot be programmed twice, so only the preparation is repeated
+    if( _stream )
+      _check(_flasher.retry(_prepare));
+    else
+      _check(_flasher.retry([&]() -> Flasher::Result
+      {
+        Flasher::Result _result = _prepare();
+        if( Flasher::Passed == _result )
+          _result = _flasher.startLoader();
+        // wait until the image has been loaded
+        _waitForImage();
+        // a plan programs only the pages in its blocks
+        const Image _image = _applyPlan ? _delta.restrict(_loader.image()) : _loader.image();
+        if( Flasher::Passed == _result )
+          _result = _flasher.program(_image);
+        if( Flasher::Passed == _result && _options.verify_ )
+          _result = _flasher.verify(_image);
+        return _result;
+      }));
+  }
+  // program pages as soon as they are complete
+  if( _stream )
+  {
+    _out << "Writing streamed image" << endl;
+    unsigned long _count=0;
+    unsigned long _address;
+    QByteArray _page;
+    while( file.readPage(_address, _page) )
+    {
+      if( Image::isBlank(_page.constData(), _page.size()) )
+        continue;
       if( !_port.isEmpty() )
       {
-        _out << "\rWriting page at address " << HEX(_start + _cur) << " " << progress(_cur,_image.size(),60) << "     \b\b\b\b" << flush;
+        _out << "\rWriting page at address " << HEX(_address) << flush;
         // program current page
-        if( Connection::Ready != _c.programPage( _start + _cur, _page ) )
+        if( Connection::Ready != _c.programPage( _address, _page ) )
+          _check(Flasher::ProgramFailed);
+        // the page is gone after this loop, so read it back right away
+        if( _options.verify_ )
         {
-          _err << "ERROR: programming page failed" << endl;
-          exit(-1);
+          char _read[Image::PageSize];
+          if( Connection::Ready != _c.readPage(_address, _read) || 0 != memcmp(_read, _page.constData(), Image::PageSize) )
+          {
+            _out << endl << "verification failed at " << HEX(_address) << endl;
+            _check(Flasher::VerifyFailed);
+          }
         }
       }
       else
-        _out << HEX(_start + _cur) << ": " << _page.left(16).toHex() << "..." << _page.right(16).toHex() << endl;
+        _out << HEX(_address) << ": " << _page.left(16).toHex() << "..." << _page.right(16).toHex() << endl;
       _count++;
     }
+    if( file.outOfOrder() )
+    {
+      _err << "ERROR: unexpected SRecord order in stream" << endl;
+      exit(-1);
+    }
+    _out << "\n" << _count << " relevant pages = " << (_count*0x100)/1024 << "KB" << endl;
+    _report();
+    qDeleteAll(_files);
+    return 0;
+  }
+  // wait until the image has been loaded
+  _waitForImage();
+  if( _port.isEmpty() )
+  {
+    // dry run
+    const Image _image = _applyPlan ? _delta.restrict(_loader.image()) : _loader.image();
+    _out << "Writing image from " << HEX(_image.start()) << " to " << HEX(_image.endAddress()-1) << " = " << _image.size()/1024 << "KB" << endl;
+    for( Image::const_iterator _it = _image.begin(); _it != _image.end(); ++_it )
+    {
+      const Image::Page _page = *_it;
+      _out << HEX(_page.address_) << ": " << QByteArray::fromRawData(_page.data_, 16).toHex() << "..." << QByteArray::fromRawData(_page.data_ + Image::PageSize - 16, 16).toHex() << endl;
+    }
+    _out << "\n" << _image.relevantCount() << " relevant pages = " << (_image.relevantCount()*Image::PageSize)/1024 << "KB" << endl;
   }
-  _out << "\n" << _count << " relevant pages = " << (_count*0x100)/1024 << "KB" << endl;
+  _report();
+  qDeleteAll(_files);
   return 0;//_a.exec();
 }
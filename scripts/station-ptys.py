@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""Simulate boards being plugged into a flash station.
+
+Creates pseudo terminals, links them into a directory as ttyN, keeps them
+for a while and removes them again, so station mode sees ports appear and
+disappear:
+
+  scripts/station-ptys.py --dir /tmp/station --count 4 --rounds 3 &
+  flash-renesas --station '/tmp/station/tty*' image.mot
+
+Nothing answers behind the ptys, so each port is reported as FAIL (no
+response at 9600 baud). Every round must report a START and a FAIL line
+per port; ports must not be flashed twice while they stay linked.
+"""
+import argparse
+import os
+import pty
+import time
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--dir", default="/tmp/station", help="directory to link the ptys into")
+    parser.add_argument("--count", type=int, default=2, help="number of ports per round")
+    parser.add_argument("--rounds", type=int, default=1, help="how often ports appear and disappear")
+    parser.add_argument("--present", type=float, default=20.0, help="seconds a port stays linked")
+    parser.add_argument("--absent", type=float, default=2.0, help="seconds between rounds")
+    args = parser.parse_args()
+
+    os.makedirs(args.dir, exist_ok=True)
+    for n in range(args.rounds):
+        ports = []
+        # plug in
+        for i in range(args.count):
+            master, slave = pty.openpty()
+            link = os.path.join(args.dir, "tty%d" % i)
+            if os.path.lexists(link):
+                os.unlink(link)
+            os.symlink(os.ttyname(slave), link)
+            ports.append((master, slave, link))
+            print("round %d: added %s -> %s" % (n + 1, link, os.ttyname(slave)), flush=True)
+        time.sleep(args.present)
+        # unplug
+        for master, slave, link in ports:
+            os.unlink(link)
+            os.close(slave)
+            os.close(master)
+            print("round %d: removed %s" % (n + 1, link), flush=True)
+        time.sleep(args.absent)
+
+
+if __name__ == "__main__":
+    main()